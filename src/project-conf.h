@@ -6,8 +6,23 @@
 #undef NETSTACK_CONF_MAC 
 #define NETSTACK_CONF_MAC  csma_driver  //csma_driver //nullmac_driver // csma_driver
 
+#ifndef RAFT_LOW_POWER
+#define RAFT_LOW_POWER 0 // 1 duty cycles the radio with ContikiMAC, see raft_timer.h
+#endif
+
 #undef NETSTACK_CONF_RDC
+#if RAFT_LOW_POWER
+#define NETSTACK_CONF_RDC  contikimac_driver
+#undef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
+#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 8 // wake-ups per second, heartbeats are a multiple of them
+#undef CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION
+#define CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION 1 // shorter unicast strobes for the acks to the leader
+#else
 #define NETSTACK_CONF_RDC  nullrdc_driver //nullrdc_driver // contikimac_driver // cxmac_driver  
+#endif
+
+#undef ENERGEST_CONF_ON
+#define ENERGEST_CONF_ON 1 // radio and CPU time per Raft state, see raft_energy.h
 
 #undef NETSTACK_CONF_FRAMER
 #define NETSTACK_CONF_FRAMER framer_802154 // framer_nullmac
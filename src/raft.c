@@ -14,8 +14,6 @@
 
 //#include "net/ip/uip-debug.h"
 
-#include "lib/random.h"
-
 #include "node-id.h"
 
 //#include "ieee-addr.h"
@@ -28,10 +26,59 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+
+
+//default state machine until the application plugs in its own:
+//counts the applied entries and sums their values
+
+static uint32_t appliedCount;
+
+static uint32_t appliedSum;
+
+static void counter_apply(uint32_t index, uint8_t value) {
+
+  ++appliedCount;
+
+  appliedSum += value;
+
+}
+
+static uint16_t counter_save(uint8_t *buf, uint16_t size) {
 
+  int i = 0;
+
+  if (size < 8)
+    return 0;
+
+  for (i = 0; i < 4; ++i) {
+    buf[i] = (appliedCount >> (8 * i)) & 0xff;
+    buf[4 + i] = (appliedSum >> (8 * i)) & 0xff;
+  }
+
+  return 8;
+
+}
+
+static void counter_restore(const uint8_t *buf, uint16_t len) {
+
+  int i = 0;
+
+  appliedCount = 0;
+  appliedSum = 0;
 
+  if (len < 8)
+    return;
 
-uint8_t get_timeout(void);
+  for (i = 0; i < 4; ++i) {
+    appliedCount |= (uint32_t)buf[i] << (8 * i);
+    appliedSum |= (uint32_t)buf[4 + i] << (8 * i);
+  }
+
+}
+
+static const struct StateMachine counterStateMachine = {counter_apply, counter_save, counter_restore};
 /*
 static unsigned short int entries[10] = {0,0,0,0,0,0,0,0,0};
 
@@ -47,7 +94,7 @@ void raft_init(struct Raft *node) {
 
   node->currentTerm=0;
 
-  //int i = 0;
+  int i = 0;
 
   //ieee_addr_cpy_to(node->macAddr, 8);
 
@@ -59,22 +106,21 @@ void raft_init(struct Raft *node) {
 
     node->votedFor[i] = 0;*/
 
-  node->timeout = get_timeout();
+  raft_timer_init(&node->timer);
 
   node->state = follower;
 
-  node->totalVotes = 0;
+  raft_energy_init(&node->energy, follower);
 
-  node->totalCommits = 0;
+  raft_quorum_start(&node->votes, 0);
 
+  node->voters = RAFT_BITMAP_FIRST(TOTAL_NODES);
 
+  node->preVote = false;
 
-  int i = 0;
-  for (i = 0; i < 15; ++i)
 
-    node->log[i] = 0;
 
-  //note: i havent applied the stable storage on all servers bit
+  raft_log_init(&node->log);
 
   
 
@@ -83,9 +129,12 @@ void raft_init(struct Raft *node) {
 
   //volatile state on leaders
 
-  node->nextIndex=0;
+  node->broadcastIndex=0;
 
-  node->matchIndex=0;
+  node->idle = 0;
+
+  for (i = 0; i < RAFT_MAX_NODES; ++i)
+    node->peers[i].id = i + 1;
 
   
 
@@ -114,46 +163,34 @@ void raft_init(struct Raft *node) {
     node->entries[j] = 0; } */
 
   node->leaderCommit = 0;
-  //node->voterSet = init_set(node);
-
-  
-
-};
-
 
+  node->lastApplied = 0;
 
-uint8_t get_timeout() {
+  //an application that registered before us keeps its own
 
-  //contiki random function (0 - 65,535)
+  if (node->stateMachine == NULL)
+    node->stateMachine = &counterStateMachine;
 
-  uint16_t r = random_rand();
+  raft_snapshot_init(&node->snapshot);
 
-  printf("RAND: %d\n", r);
+  raft_proposal_init(&node->proposals);
 
+  //term, vote and log survive a reboot in stable storage
 
+  raft_storage_recover(node);
 
-  //scale value to min and max timeout range
+  raft_config_update(node);
 
-  float _r = (float)r;
-
-  float _randMax = (float)RANDOM_RAND_MAX;
-
-  float _maxTimeout = (float)MAX_TIMEOUT;
-
-  float _minTimeout = (float)MIN_TIMEOUT;
-
-  float res = (_r / _randMax) * (_maxTimeout - _minTimeout) + _minTimeout;
-
-
-
-  return (const uint8_t)res;
+  
 
-}
+};
 
 
 
 void raft_set_follower(struct Raft *node) {
 
+  raft_energy_charge(&node->energy, follower);
+
   node->state = follower;
 
   /*int i = 0;
@@ -164,14 +201,20 @@ void raft_set_follower(struct Raft *node) {
 
   node->votedFor = 0;
 
-  node->totalVotes = 0;
+  raft_quorum_start(&node->votes, node->term);
+
+  node->preVote = false;
 
 
   leds_on(LEDS_RED);
 
   leds_off(LEDS_GREEN);
 
-  printf("Set State: Follower \n");
+  TRACE_INFO("Set State: Follower \n");
+
+  TRACE_EVENT(trace_follower, 0, node->term, node->lastLogIndex);
+
+  raft_proposal_drop(&node->proposals);
 
   raft_print(node);
 
@@ -181,6 +224,8 @@ void raft_set_follower(struct Raft *node) {
 
 void raft_set_candidate(struct Raft *node) {
 
+  raft_energy_charge(&node->energy, candidate);
+
   node->state = candidate;
   //node->id = id;
 
@@ -190,13 +235,20 @@ void raft_set_candidate(struct Raft *node) {
 
   node->votedFor = node_id;
 
-  node->totalVotes = 1;
+  raft_quorum_start(&node->votes, node->term);
+  raft_quorum_add(&node->votes, node->term, node->id);
+
+  node->preVote = false;
 
   leds_on(LEDS_RED);
 
   leds_on(LEDS_GREEN);
 
-  printf("Set State: Candidate \n");
+  TRACE_INFO("Set State: Candidate \n");
+
+  TRACE_EVENT(trace_candidate, 0, node->term, node->lastLogIndex);
+
+  raft_proposal_drop(&node->proposals);
 
   raft_print(node);
 
@@ -206,312 +258,232 @@ void raft_set_candidate(struct Raft *node) {
 
 void raft_set_leader(struct Raft *node) {
 
+  raft_energy_charge(&node->energy, leader);
+
   node->state = leader;
 
-  leds_on(LEDS_GREEN);
+  //resend everything uncommitted, followers skip what they already hold.
+  //Anything before the log's first entry is committed and compacted, the
+  //followers that lack it get InstallSnapshot after their NACK
 
-  leds_off(LEDS_RED);
+  if (node->leaderCommit < node->commitIndex)
+    node->leaderCommit = node->commitIndex;
 
-  printf("Set State: Leader \n");
+  node->broadcastIndex = node->leaderCommit < node->log.firstIndex - 1 ? \
+    node->log.firstIndex - 1 : node->leaderCommit;
 
-  raft_print(node);
+  node->idle = 0;
 
-}
+  int i = 0;
 
+  for (i = 0; i < RAFT_MAX_NODES; ++i) {
+    node->peers[i].nextIndex = node->broadcastIndex + 1;
+    node->peers[i].matchIndex = 0;
+    node->peers[i].inflight = 0;
+    node->peers[i].snapshot = false;
+    node->peers[i].repair = false;
+  }
 
+  leds_on(LEDS_GREEN);
 
+  leds_off(LEDS_RED);
 
+  TRACE_INFO("Set State: Leader \n");
 
-void raft_print(struct Raft *node) {
+  TRACE_EVENT(trace_leader, 0, node->term, node->lastLogIndex);
 
-  printf("NODE: {term: %ld, ", node->term);
+  raft_print(node);
 
-  //int i = 0;
+}
 
-  printf("id: %d, ", node->id);
 
-  printf("votedFor: %d, ", node->votedFor);
 
-  /*
 
-  for (i = 0; i < 8; ++i)
 
-    printf("%d", node->macAddr[i]);
+//apply up to max committed entries to the state machine in log order,
+//true while more are waiting
 
-  printf(",\n\t votedFor: ");
+bool raft_apply(struct Raft *node, uint16_t max) {
 
-  for (i = 0; i < 8; ++i)
+  for (; max > 0 && node->lastApplied < node->commitIndex; --max) {
 
-    printf("%d", node->votedFor[i]); */
+    struct LogEntry *entry = raft_log_get(&node->log, node->lastApplied + 1);
 
-  printf("timeout: %d, state: %d, totalVotes: %d}\n",\
-   node->timeout, node->state, node->totalVotes);
- /* printf("totalCommits: %d, commitIndex: %d, lastApplied: %d, nextIndex, %d", node->totalCommits, \
-    node->commitIndex, node->lastApplied, node->nextIndex);
-  printf("matchIndex: %d, lastLogIndex: %d, lastLogTerm: %d, prevLogIndex: %d, ", \
-    node->matchIndex, node->lastLogIndex, node->lastLogTerm, node->prevLogIndex);
-  printf("prevLogTerm: %d, leaderCommit: %d \n", node->prevLogTerm, node->leaderCommit); */
+    if (entry == NULL)
+      break;
 
-}
+    ++node->lastApplied;
 
+    //configuration changes took effect when they were appended
+    if (entry->kind == raft_entry_data)
+      node->stateMachine->apply(node->lastApplied, entry->value);
 
+  }
 
-bool id_compare(unsigned short int a, unsigned short int b) {
+  raft_proposal_settle(&node->proposals, &node->log, node->lastApplied);
 
-    if (a != b)
+  return node->lastApplied < node->commitIndex && \
+    raft_log_get(&node->log, node->lastApplied + 1) != NULL;
 
-      return false;
+}
 
-    else  return true;
 
-}
 
+//replication state of a follower, NULL for ourselves or unknown ids
 
+struct Peer *raft_peer(struct Raft *node, unsigned short int id) {
 
-/*
+  if (id == 0 || id > RAFT_MAX_NODES || id == node->id)
+    return NULL;
 
-bool mac_compare(uint8_t a[], uint8_t b[]) {
+  return &node->peers[id - 1];
 
-  int i = 0;
+}
 
-  for (i = 0; i < 8; ++i) {
 
-    if (a[i] != b[i])
 
-      return false;
+//highest entry known to be stored on node id, our own log counts as one
+//copy of everything
 
-  }
+static uint32_t match_index(struct Raft *node, unsigned short int id) {
 
-  return true;
+  return id == node->id ? node->lastLogIndex : node->peers[id - 1].matchIndex;
 
 }
 
-*/
-
-// RAFT MSG Functions
 
-void build_msg(struct Msg *msg);
 
-void build_election(struct Election *elect, uint32_t term, unsigned short int from, \
-  uint8_t lastLogIndex, uint8_t lastLogTerm) {
+//leader: commit the highest entry of this term stored on a quorum. Each
+//match index is a candidate, the nodes holding it are a bitmap
 
-  elect->type = election;
-  elect->bType = broadcast_msg;
+bool raft_advance_commit(struct Raft *node) {
 
-  elect->term = term;
+  uint32_t n = node->leaderCommit;
+  unsigned short int i, j;
 
-  elect->from = node_id;
+  for (i = 1; i <= RAFT_MAX_NODES; ++i) {
+    uint32_t m = match_index(node, i);
+    raft_bitmap_t acked = 0;
 
-  /*
+    if (m <= n || !(node->voters & RAFT_BIT(i)))
+      continue;
 
-  int i = 0;
+    for (j = 1; j <= RAFT_MAX_NODES; ++j)
+      if (match_index(node, j) >= m)
+        acked |= RAFT_BIT(j);
 
-  for (i = 0; i < 8; ++i)
+    if (raft_quorum_met(acked, node->voters))
+      n = m;
+  }
 
-    elect->from[i] = from[i];*/
+  if (n <= node->leaderCommit || raft_log_term(&node->log, n) != node->term)
+    return false;
 
-  elect->lastLogIndex = lastLogIndex;\
+  node->leaderCommit = n;
+  node->commitIndex = n;
 
-  elect->lastLogTerm = lastLogTerm; 
+  TRACE_INFO("Commited to index: %lu \n", (unsigned long)node->leaderCommit);
 
-}
+  TRACE_EVENT(trace_commit, 0, node->term, node->leaderCommit);
 
+  return true;
 
+}
 
 
 
-void build_vote(struct Vote *voteMsg, uint32_t term, unsigned short int from,\
-  unsigned short int voteFor, bool voteGranted) {
+//make room in a full log: snapshot everything applied so far and drop it
+//from the log. Committed entries raft_apply_process has not reached yet
+//stay, so a receive callback never applies any; the batch that finds no
+//room is cut short and the rest is sent again
 
-  voteMsg->type = vote;
-  voteMsg->bType = unicast_msg;
+void raft_compact(struct Raft *node) {
 
-  voteMsg->term = term;
+  raft_snapshot_take(node);
 
-  voteMsg->from = node_id;
+}
 
-  voteMsg->voteFor = voteFor;
 
-  /*
 
-  int i = 0;
+#if RAFT_TRACE_LEVEL >= RAFT_TRACE_DEBUG
 
-  for (i = 0; i < 8; ++i)
+void raft_print(struct Raft *node) {
 
-    voteMsg->from[i] = from[i];
+  printf("NODE: {term: %lu, ", (unsigned long)node->term);
 
-  for (i = 0; i < 8; ++i)
+  //int i = 0;
 
-    voteMsg->voteFor[i] = voteFor[i]; */
+  printf("id: %d, ", node->id);
 
-  voteMsg->voteGranted = voteGranted;
+  printf("votedFor: %d, ", node->votedFor);
 
-}
+  /*
 
+  for (i = 0; i < 8; ++i)
 
+    printf("%d", node->macAddr[i]);
 
-void build_heartbeat(struct Heartbeat *heart, uint32_t term, 
-  unsigned short int from, uint8_t prevLogIndex,
+  printf(",\n\t votedFor: ");
 
-               uint8_t prevLogTerm, uint8_t nextIndex,/*uint8_t prevValue,*/ \
-  uint8_t value, uint8_t leaderCommit) {
+  for (i = 0; i < 8; ++i)
 
-  heart->type = heartbeat;
-  heart->bType = broadcast_msg;
+    printf("%d", node->votedFor[i]); */
 
-  heart->term = term;
+  printf("timeout: %u, state: %d, votes: 0x%lx}\n",\
+   (unsigned)node->timer.timeout, node->state, (unsigned long)node->votes.granted);
+ /* printf("totalCommits: %d, commitIndex: %d, lastApplied: %d, nextIndex, %d", node->totalCommits, \
+    node->commitIndex, node->lastApplied, node->nextIndex);
+  printf("matchIndex: %d, lastLogIndex: %d, lastLogTerm: %d, prevLogIndex: %d, ", \
+    node->matchIndex, node->lastLogIndex, node->lastLogTerm, node->prevLogIndex);
+  printf("prevLogTerm: %d, leaderCommit: %d \n", node->prevLogTerm, node->leaderCommit); */
 
-  heart->from = node_id;
+}
 
-  /*int i = 0;
+#endif
 
-  for (i = 0; i < 8; ++i)
 
-    heart->from[i] = from[i];*/
 
-  heart->prevLogIndex = prevLogIndex;
+bool id_compare(unsigned short int a, unsigned short int b) {
 
-  heart->prevLogTerm = prevLogTerm;
-  //heart->entries[10] = array1[10];
+    if (a != b)
 
-  //heart->prevValue = prevValue;
-  heart->value = value;
-  heart->nextIndex = nextIndex;
-  
+      return false;
 
-  heart->leaderCommit = leaderCommit;
+    else  return true;
 
 }
 
 
 
-void build_response(struct Response *response, uint8_t commitIndex, 
-  uint8_t currentTerm, unsigned short int from,
- uint8_t prevLogIndex, 
-  uint8_t prevLogTerm, bool success) {
+/*
 
-response->type = respond;
-response->bType = unicast_msg;
-response->commitIndex=commitIndex;
-response->currentTerm=currentTerm;
-response->from = node_id;
-response->prevLogIndex=prevLogIndex;
-response->prevLogTerm=prevLogTerm;
+bool mac_compare(uint8_t a[], uint8_t b[]) {
 
-response->success=success;
+  int i = 0;
 
-}
+  for (i = 0; i < 8; ++i) {
 
-//SET FUNCTIONS
-void init_set(struct Raft *node) {
-  node->voterSet->length = 0;
-  int i = 0;
-  for (; i< TOTAL_NODES; i++){
-      node->voterSet->members[i];
-    }
-};
+    if (a[i] != b[i])
 
-void insert_set_member(struct Raft *node, int member){
-    bool in_set = false;
-    int i = 0;
-    for (; i < node->voterSet->length; i++)
-        if (node->voterSet->members[i] == member){
-            in_set = true;
-        }
-    if (!in_set) {
-        node->voterSet->length ++;
-        node->voterSet->members[node_id - 1] = node_id;
-        }
-    }
-
-bool check_empty_set(struct Raft *node){
-    return (node->voterSet->length == 0);
-}
+      return false;
 
-bool is_set_member(struct Raft *node, int value)
-{
-  // if we can find the value in the set's members, it is in the set
-  int i = 0;
-  for (; i < node->voterSet->length; i++)
-    if (node->voterSet->members[i] == value) return true;
-  
-  // if after checking all the set's members we can't find the value, it is 
-  // not a member of the set
-  return false;
-}
-// prints out the set
-void print_set(struct Raft *node)
-{
-  // loop through the array of set values, print each of them out separated by 
-  // a comma, except the last element - instead output a newline afterwards
-  int i = 0;
-  for (; i < node->voterSet->length; i++)
-    if (i == (node->voterSet->length - 1))
-      printf("%d\n", node->voterSet->members[i]);
-    else
-      printf("%d,", node->voterSet->members[i]);
-}
+  }
 
+  return true;
 
-//try without malloc and realloc
-/*
-Set* init_set() {
-    Set *new_set = malloc(sizeof(Set));
-    new_set->length = 0;
-    new_set->members = malloc(sizeof(int));
-    return new_set;
-};
+}
 
+*/
 
+// RAFT MSG Functions
 
-void insert_set_member(Set *set, int member){
-    bool in_set = false;
-    int i = 0;
-    for (i; i < set->length; i++)
-        if (set->members[i] == member){
-            in_set = true;
-        }
-    if (!in_set) {
-        void *tmp = realloc(set->members, sizeof(int)*(set->length+1));
-        if (tmp) {
-        set->members =  tmp;
-        set->members[set->length] = member;
-        set->length = set->length+1;
-        }
-    }
-}
+//builders and decoders live in raft_wire.c
 
 
-bool check_empty_set(Set *set){
-    return (set->length == 0);
-}
 
-bool is_set_member(Set *set, int value)
-{
-  // if we can find the value in the set's members, it is in the set
-  int i = 0;
-  for (i; i < set->length; i++)
-    if (set->members[i] == value) return true;
-  
-  // if after checking all the set's members we can't find the value, it is 
-  // not a member of the set
-  return false;
-}
-// prints out the set
-void print_set(Set *set)
-{
-  // loop through the array of set values, print each of them out separated by 
-  // a comma, except the last element - instead output a newline afterwards
-  int i = 0;
-  for (i; i < set->length; i++)
-    if (i == (set->length - 1))
-      printf("%d\n", set->members[i]);
-    else
-      printf("%d,", set->members[i]);
-}
-*/
+//RAFT PRINT FUNCTIONS, only in debug builds
 
-//RAFT PRINT FUNCTIONS
+#if RAFT_TRACE_LEVEL >= RAFT_TRACE_DEBUG
 
 
 
@@ -524,7 +496,7 @@ void msg_print(uint32_t currTerm, uint8_t node_id, struct Msg *msg) {
   printf("%d", msg->from);  
   //uip_debug_ipaddr_print(from);
 
-  printf(" in term %ld: {type: %d, term: %ld}\n", currTerm, msg->type, msg->term);
+  printf(" in term %lu: {type: %d, term: %lu}\n", (unsigned long)currTerm, msg->type, (unsigned long)msg->term);
 
 
   /*
@@ -541,23 +513,16 @@ void msg_print(uint32_t currTerm, uint8_t node_id, struct Msg *msg) {
 
 
 
-void heartbeat_print(struct Heartbeat *heart) {
-
-
-  printf("HEARTBEAT: {type: %d, term: %ld, ", heart->type, heart->term);
+void append_entries_print(struct AppendEntries *appendMsg) {
 
-  // uip_debug_ipaddr_print(&heart->leaderId);
 
-  printf("nextIndex: %d, prevLogIndex: %d, prevLogTerm: %d, leaderCommit: %d} \n ",
+  printf("APPEND ENTRIES: {type: %d, term: %lu, ", appendMsg->type, (unsigned long)appendMsg->term);
 
-         heart->nextIndex, heart->prevLogIndex, heart->prevLogTerm, heart->leaderCommit);
-    /*
+  printf("prevLogIndex: %lu, prevLogTerm: %lu, leaderCommit: %lu, entryTerm: %lu, entryKind: %d, idle: %d, count: %d}\n",
 
-  int i = 0;
-
-  for (i = 0; i < 10; ++i)
-
-    printf("%d", heart->entries[i]);*/
+         (unsigned long)appendMsg->prevLogIndex, (unsigned long)appendMsg->prevLogTerm, \
+         (unsigned long)appendMsg->leaderCommit, (unsigned long)appendMsg->entryTerm, \
+         appendMsg->entryKind, appendMsg->idle, appendMsg->count);
 
 
 
@@ -568,9 +533,11 @@ void heartbeat_print(struct Heartbeat *heart) {
 void election_print(struct Election *elect) {
   //printf("BROADCAST MESSAGE SENT \n");
 
-  printf("ELECTION CALLED: {type: %d, term: %ld, lastLogIndex: %d, lastLogTerm: %d}\n",
+  printf("%s: {type: %d, term: %lu, lastLogIndex: %lu, lastLogTerm: %lu}\n",
 
-         elect->type, elect->term, elect->lastLogIndex, elect->lastLogTerm);
+         elect->type == pre_election ? "PRE-ELECTION CALLED" : "ELECTION CALLED", \
+         elect->type, (unsigned long)elect->term, (unsigned long)elect->lastLogIndex, \
+         (unsigned long)elect->lastLogTerm);
 
 }
 
@@ -579,9 +546,10 @@ void election_print(struct Election *elect) {
 void vote_print(struct Vote *vote) {\
   //printf("UNICAST MESSAGE SENT \n");
 
-  printf("VOTED FOR ELECTION: {type: %d, term: %ld, voteFor: %d, ",
+  printf("%s: {type: %d, term: %lu, voteFor: %d, ",
 
-         vote->type, vote->term, vote->voteFor);
+         vote->type == pre_vote ? "PRE-VOTED FOR ELECTION" : "VOTED FOR ELECTION", vote->type, \
+         (unsigned long)vote->term, vote->voteFor);
   /*
 
   int i = 0;
@@ -596,14 +564,78 @@ void vote_print(struct Vote *vote) {\
 
 void response_print(struct Response *response){
   //printf("UNICAST MESSAGE SENT \n");
-  printf("RESPONSE: {commitIndex: %d, currentTerm: %d, from: %d, prevLogIndex: %d, \
-    prevLogTerm: %d, ", response->commitIndex, response->currentTerm, \
-    response->from, response->prevLogIndex,\
-    response->prevLogTerm);
+  printf("RESPONSE: {commitIndex: %lu, term: %lu, from: %d, prevLogIndex: %lu, \
+    prevLogTerm: %lu, ", (unsigned long)response->commitIndex, (unsigned long)response->term, \
+    response->from, (unsigned long)response->prevLogIndex,\
+    (unsigned long)response->prevLogTerm);
   printf("success: %s} \n", response->success ? "true" : "false");
 }
 
 
+void install_snapshot_print(struct InstallSnapshot *chunk){
+  printf("INSTALL SNAPSHOT: {term: %lu, to: %d, lastIndex: %lu, lastTerm: %lu, voters: 0x%lx, ", \
+    (unsigned long)chunk->term, chunk->to, (unsigned long)chunk->lastIndex, \
+    (unsigned long)chunk->lastTerm, (unsigned long)chunk->voters);
+  printf("offset: %d, count: %d, total: %d} \n", chunk->offset, chunk->count, chunk->total);
+}
+
+void snapshot_response_print(struct SnapshotResponse *response){
+  printf("SNAPSHOT RESPONSE: {term: %lu, from: %d, lastIndex: %lu, offset: %d} \n", \
+    (unsigned long)response->term, response->from, (unsigned long)response->lastIndex, response->offset);
+}
+
+
+//decodes an outgoing or incoming frame and prints it with the matching printer
+
+void frame_print(const uint8_t *buf, uint16_t len){
+  union {
+    struct Msg msg;
+    struct Election elect;
+    struct Vote vote;
+    struct AppendEntries append;
+    struct Response response;
+    struct InstallSnapshot chunk;
+    struct SnapshotResponse snapshotResponse;
+  } m;
+
+  if (!decode_msg(buf, len, &m.msg)) {
+    printf("MALFORMED FRAME: {len: %d} \n", len);
+    return;
+  }
+
+  switch (m.msg.type) {
+    case election:
+    case pre_election:
+      if (decode_election(buf, len, &m.elect))
+        election_print(&m.elect);
+      break;
+    case vote:
+    case pre_vote:
+      if (decode_vote(buf, len, &m.vote))
+        vote_print(&m.vote);
+      break;
+    case append:
+      if (decode_append_entries(buf, len, &m.append))
+        append_entries_print(&m.append);
+      break;
+    case respond:
+      if (decode_response(buf, len, &m.response))
+        response_print(&m.response);
+      break;
+    case install_snapshot:
+      if (decode_install_snapshot(buf, len, &m.chunk))
+        install_snapshot_print(&m.chunk);
+      break;
+    case snapshot_ack:
+      if (decode_snapshot_response(buf, len, &m.snapshotResponse))
+        snapshot_response_print(&m.snapshotResponse);
+      break;
+    default:
+      printf("UNKNOWN FRAME: {type: %d, len: %d} \n", m.msg.type, len);
+  }
+}
+
+
 void broadcast_print(struct Msg *msg, struct Raft *node){
   if (msg->bType == broadcast_msg && msg->from == node->id) {
     printf("BROADCAST MESSAGE SENT \n");
@@ -622,4 +654,6 @@ void broadcast_print(struct Msg *msg, struct Raft *node){
   }
 }
 
+#endif
+
 
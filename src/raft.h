@@ -10,28 +10,150 @@
 
 #include "contiki.h"
 
+#include <stddef.h>
+
+#include "raft_log.h"
+
+#include "raft_snapshot.h"
+
+#include "raft_storage.h"
+
+#include "raft_wire.h"
+
+#include "raft_trace.h"
+
+#include "raft_timer.h"
+
+#include "raft_proposal.h"
+
+#include "raft_quorum.h"
+
+#include "raft_config.h"
+
+#include "raft_energy.h"
+
 
 
 #define UDP_PORT 1234 //UDP Broadcast Port for messaging
 
-#define MIN_TIMEOUT 5 //minimum value for timeout
+#ifndef RAFT_CLIENT_INTERVAL_MS
+#define RAFT_CLIENT_INTERVAL_MS 2000 //between proposals of the demo client in raft_node.c, 0 turns it off
+#endif
+
+#define RAFT_MAX_PAYLOAD 96 //bytes of a 127 byte 802.15.4 frame left after MAC and rime headers, largest encoded message
+
+#ifndef TOTAL_NODES
+#define TOTAL_NODES 3 //nodes 1 ... TOTAL_NODES form the initial cluster
+#endif
+
+#ifndef RAFT_MAX_NODES
+#define RAFT_MAX_NODES (TOTAL_NODES + 2) //highest node id in the peer table, room for nodes joining later
+#endif
+
+#if TOTAL_NODES > RAFT_MAX_NODES || RAFT_MAX_NODES > RAFT_BITMAP_NODES
+#error "TOTAL_NODES, RAFT_MAX_NODES and node bitmaps do not fit"
+#endif
+
+#ifndef RAFT_APPLY_BATCH
+#define RAFT_APPLY_BATCH 8 //entries raft_apply_process applies before it yields
+#endif
 
-#define MAX_TIMEOUT 10 //maximum value for timeout
+#ifndef RAFT_MAX_INFLIGHT
+#define RAFT_MAX_INFLIGHT 4 //unacknowledged AppendEntries batches per follower
+#endif
 
-#define LEADER_SEND_INTERVAL (MIN_TIMEOUT / 2)
+#ifndef RAFT_QUIET_ACKS
+#define RAFT_QUIET_ACKS 0 //0 acks every AppendEntries, n only those that add entries or await commit, and every n-th other
+#endif
 
-#define TOTAL_NODES 3 //total number of nodes in network
+#ifndef RAFT_SHARED_REPAIR
+#define RAFT_SHARED_REPAIR 0 //1 repairs every lagging follower with one broadcast at the next heartbeat
+#endif
+
+#ifndef RAFT_ACK_SLOT_MS
+#define RAFT_ACK_SLOT_MS 0 //followers answer a leader broadcast in turn, one slot of this length per node id below theirs wrapped within a heartbeat, 0 at once
+#endif
+
+#if 2 * RAFT_ACK_SLOT_MS > RAFT_HEARTBEAT_MS
+#error "RAFT_ACK_SLOT_MS leaves no room for two ack slots in RAFT_HEARTBEAT_MS"
+#endif
+
+#ifndef RAFT_OVERHEAR
+#define RAFT_OVERHEAR 0 //followers broadcast their acks and commit on a quorum of them, see struct Overheard
+#endif
+
+#if RAFT_OVERHEAR && !RAFT_ACK_SLOT_MS
+#error "RAFT_OVERHEAR needs RAFT_ACK_SLOT_MS, broadcast acks sent at once collide and get no MAC retry"
+#endif
 
 typedef enum {false = 0, true = !false} bool;
 
+#include "raft_step.h"
+
 
 enum states {follower, candidate, leader};
 
-enum msg_types {heartbeat, election, vote, respond};
+enum msg_types {append, election, vote, respond, install_snapshot, snapshot_ack, pre_election, pre_vote, msg_types_count};
 enum broadcast_types {unicast_msg, broadcast_msg};
 
 
 
+// replicated state machine, committed entries are applied to it in log order
+
+struct StateMachine {
+
+  void (* apply)(uint32_t index, uint8_t value);
+
+  uint16_t (* save)(uint8_t *buf, uint16_t size); //writes a snapshot image, returns its length
+
+  void (* restore)(const uint8_t *buf, uint16_t len);
+
+};
+
+
+
+// leader's view of one follower, node ids run from 1 to RAFT_MAX_NODES
+
+struct Peer {
+
+  unsigned short int id;
+
+  uint32_t nextIndex;  //next entry to send
+
+  uint32_t matchIndex; //highest entry known to be replicated
+
+  uint8_t inflight;    //batches sent since the last ack
+
+  bool snapshot;       //being caught up with InstallSnapshot instead
+
+  bool repair;         //RAFT_SHARED_REPAIR: include in the next shared repair
+
+  uint16_t snapshotOffset;
+
+};
+
+
+
+// follower's record of the acks it overheard in one term. In this mode
+// acks are broadcast, so every follower hears what the others hold and
+// commits an entry of the term once the leader, itself and enough peers
+// acked it, without waiting for leaderCommit in the next AppendEntries.
+// A broadcast costs a full strobe under ContikiMAC, it suits an always-on radio
+
+struct Overheard {
+
+  uint32_t term;                  //acks of this term only
+
+  unsigned short int leader;      //whose AppendEntries we accepted this term
+
+  uint32_t match;                 //our log matches the leader's up to here
+
+  uint32_t acked[RAFT_MAX_NODES]; //highest index acked, slot id - 1
+
+};
+
+
+
 struct Raft {
 
   uint32_t term;
@@ -42,48 +164,65 @@ struct Raft {
 
   unsigned short int votedFor;
 
-  uint8_t timeout;
+  struct ElectionTimer timer;
 
   enum states state;
 
-  uint8_t totalVotes;
+  struct Quorum votes; //votes or pre-votes of our running election, our own included
+
+  raft_bitmap_t voters; //node ids whose votes and acks make a quorum, see raft_config.h
+
+  uint32_t configIndex; //latest configuration change in the log, 0 for none
 
-  uint8_t totalCommits;  
+  bool preVote; //asking for pre-votes, term and votedFor are left alone until a quorum grants
 
-  uint8_t log[15];
+  struct RaftLog log;
 
   
 
-  uint8_t commitIndex;
+  uint32_t commitIndex;
 
-  uint8_t lastApplied;
+  uint32_t lastApplied;
 
   
 
-  unsigned short int nextIndex;
+  uint32_t broadcastIndex; //last entry broadcast to the followers that are in sync
 
-  unsigned short int matchIndex;
+  uint8_t idle; //leader: heartbeat interval is RAFT_BEAT_TICKS(idle), grows while nothing is pending
+
+  uint8_t quiet; //follower: AppendEntries left unacknowledged since the last ack, see RAFT_QUIET_ACKS
+
+  struct Peer peers[RAFT_MAX_NODES]; //slot id - 1, our own slot is unused
 
   
 
-  uint8_t lastLogIndex;
+  uint32_t lastLogIndex;
 
-  uint8_t lastLogTerm;
+  uint32_t lastLogTerm;
 
   
 
-  uint8_t prevLogIndex;
+  uint32_t prevLogIndex;
+
+  uint32_t prevLogTerm;
+
 
-  uint8_t prevLogTerm;
 
 
 
+  uint32_t leaderCommit;
 
+  const struct StateMachine *stateMachine;
 
-  uint8_t entries[10]; 
+  struct Snapshot snapshot;
 
-  uint8_t leaderCommit;
-  struct Set *voterSet;
+  struct ProposalQueue proposals;
+
+  struct RaftEnergy energy;
+
+#if RAFT_OVERHEAR
+  struct Overheard overheard;
+#endif
 
 
 
@@ -92,20 +231,15 @@ struct Raft {
 };
 
 
-struct Set
-{
-    /* data */
-    int *members;
-    int length;
-} ;
-
+// decoded messages, see raft_wire.h for the frame layout. Every message
+// starts with the fields of struct Msg
 
 // default message struct to determine type and term on incoming messages
 
 struct Msg {
 
-  enum msg_types type;
-  enum broadcast_types bType;
+  uint8_t type;  //enum msg_types
+  uint8_t bType; //enum broadcast_types
 
   uint32_t term;
 
@@ -113,49 +247,124 @@ struct Msg {
 
 };
 
+//header of any frame
+bool decode_msg(const uint8_t *buf, uint16_t len, struct Msg *msg);
 
 
-// heartbeat message
 
-struct Heartbeat {
+// append entries message, carries a batch of log entries (none for a plain heartbeat)
 
-  enum msg_types type;
+struct AppendEntries {
 
-  enum broadcast_types bType;
+  uint8_t type;  //enum msg_types
+
+  uint8_t bType; //enum broadcast_types
 
   uint32_t term;
 
   unsigned short int from;
 
-  uint8_t prevLogIndex; // Not sure what to do with these quite yet
+  uint32_t prevLogIndex; //index of the entry before entries[0]
+
+  uint32_t prevLogTerm;
 
-  uint8_t prevLogTerm;  //
+  uint32_t leaderCommit;
 
-  uint8_t value;      //
+  uint32_t entryTerm;   //term of every entry in this batch, batches end where the term changes
 
-  uint8_t nextIndex;
+  uint8_t entryKind;    //enum raft_entry_kinds of every entry, batches end where it changes too
 
+  uint8_t idle;         //the leader's next frame follows within RAFT_BEAT_TICKS(idle)
 
-  uint8_t leaderCommit; //
+  uint8_t count;        //entries in this batch
+
+  const uint8_t *entries; //the values, in place in the received frame
 
 };
 
-void build_heartbeat(struct Heartbeat *heart, uint32_t term, unsigned short int from, uint8_t prevLogIndex,
+//*count is an upper bound on entries, on return the entries that fit in the frame,
+//0 when the first of them is no longer in the log
+uint16_t build_append_entries(uint8_t *buf, uint32_t term, unsigned short int from,
+  uint32_t prevLogIndex, uint32_t prevLogTerm, uint32_t leaderCommit, uint8_t idle,
+  struct RaftLog *log, uint8_t *count);
 
-               uint8_t prevLogTerm, uint8_t nextIndex, uint8_t value, uint8_t leaderCommit);
+bool decode_append_entries(const uint8_t *buf, uint16_t len, struct AppendEntries *appendMsg);
 
  
                
 
+// snapshot chunk, bytes offset ... offset + count - 1 of a total byte image
+
+struct InstallSnapshot {
+
+  uint8_t type;  //enum msg_types
+
+  uint8_t bType; //enum broadcast_types
+
+  uint32_t term;
+
+  unsigned short int from;
+
+  unsigned short int to;
+
+  uint32_t lastIndex;
+
+  uint32_t lastTerm;
+
+  raft_bitmap_t voters; //configuration as of lastIndex
+
+  uint16_t offset;
+
+  uint16_t total;
+
+  uint8_t count;
+
+  const uint8_t *data;    //in place in the received frame
+
+};
+
+//sends as much of the image from offset on as fits in the frame
+uint16_t build_install_snapshot(uint8_t *buf, uint32_t term, unsigned short int from,
+  unsigned short int to, struct Snapshot *snapshot, uint16_t offset);
+
+bool decode_install_snapshot(const uint8_t *buf, uint16_t len, struct InstallSnapshot *chunk);
+
+
+
+// follower's reply to a snapshot chunk, offset is the next byte it expects
+
+struct SnapshotResponse {
+
+  uint8_t type;  //enum msg_types
+
+  uint8_t bType; //enum broadcast_types
+
+  uint32_t term;
+
+  unsigned short int from;
+
+  uint32_t lastIndex;
+
+  uint16_t offset;
+
+};
+
+uint16_t build_snapshot_response(uint8_t *buf, uint32_t term, unsigned short int from,
+  uint32_t lastIndex, uint16_t offset);
+
+bool decode_snapshot_response(const uint8_t *buf, uint16_t len, struct SnapshotResponse *response);
+
+
+
 struct Response {
 
-  enum msg_types type;
-  enum broadcast_types bType;
-  uint8_t commitIndex; 
-  uint8_t currentTerm; 
+  uint8_t type;  //enum msg_types
+  uint8_t bType; //enum broadcast_types
+  uint32_t term; //follower's current term
   unsigned short int from;
-  uint8_t prevLogIndex; // Not sure what to do with these quite yet
-  uint8_t prevLogTerm;  //
+  uint32_t commitIndex; 
+  uint32_t prevLogIndex; // last index known to match (ack) or the follower's last index (nack)
+  uint32_t prevLogTerm;  //
 
   bool success;   
   
@@ -163,42 +372,47 @@ struct Response {
 
 };              
 
-void build_response(struct Response *response, uint8_t commitIndex, uint8_t currentTerm,
+uint16_t build_response(uint8_t *buf, uint32_t commitIndex, uint32_t term,
   unsigned short int from,
-  uint8_t prevLogIndex, 
-  uint8_t prevLogTerm, bool success); 
+  uint32_t prevLogIndex, 
+  uint32_t prevLogTerm, bool success); 
 
+bool decode_response(const uint8_t *buf, uint16_t len, struct Response *response);
 
 
 
 
-// start election message
+
+// start election message, as pre_election it asks whether the others would
+// vote for us in term without anyone changing term or vote yet
 
 struct Election {
 
-  enum msg_types type;
-  enum broadcast_types bType;
+  uint8_t type;  //enum msg_types
+  uint8_t bType; //enum broadcast_types
 
   uint32_t term;
 
   unsigned short int from;
 
-  uint8_t lastLogIndex; // Same as above
+  uint32_t lastLogIndex; // Same as above
 
-  uint8_t lastLogTerm;  //
+  uint32_t lastLogTerm;  //
 
 };
 
-void build_election(struct Election *elect, uint32_t term, unsigned short int from, uint8_t lastLogIndex, uint8_t lastLogTerm);
+uint16_t build_election(uint8_t *buf, uint8_t type, uint32_t term, unsigned short int from, uint32_t lastLogIndex, uint32_t lastLogTerm);
+
+bool decode_election(const uint8_t *buf, uint16_t len, struct Election *elect);
 
 
 
-// vote response for election
+// vote response for election, pre_vote answers a pre_election
 
 struct Vote {
 
-  enum msg_types type;
-  enum broadcast_types bType;
+  uint8_t type;  //enum msg_types
+  uint8_t bType; //enum broadcast_types
 
   uint32_t term;
 
@@ -210,46 +424,88 @@ struct Vote {
 
 };
 
-void build_vote(struct Vote *vote, uint32_t term, unsigned short int from, unsigned short int voteFor, bool voteGranted);
-
-//SET DECLARATIONS
-
-
-
-void init_set(struct Raft *node);
-bool check_empty_set(struct Raft *node);
-void insert_set_member(struct Raft *node, int member);
-bool is_set_member(struct Raft *node, int value);
-void print_set(struct Raft *node);
+uint16_t build_vote(uint8_t *buf, uint8_t type, uint32_t term, unsigned short int from, unsigned short int voteFor, bool voteGranted);
 
+bool decode_vote(const uint8_t *buf, uint16_t len, struct Vote *vote);
 
 /*---------*/
 
 void raft_init(struct Raft *node);
 
-void raft_print(struct Raft *node);
-
 void raft_set_follower(struct Raft *node);
 
 void raft_set_candidate(struct Raft *node);
 
 void raft_set_leader(struct Raft *node);
 
+bool raft_apply(struct Raft *node, uint16_t max);
+
+void raft_compact(struct Raft *node);
+
+struct Peer *raft_peer(struct Raft *node, unsigned short int id);
+
+//leader: true when the commit index moved
+bool raft_advance_commit(struct Raft *node);
+
+//applies committed entries outside the radio callbacks, polled when the
+//commit index moves
+PROCESS_NAME(raft_apply_process);
+
+//replace the default counter state machine. Register at boot: a running
+//node restores its snapshot into the new machine and replays the log after
+//it, so the snapshot must be one this machine can read
+void raft_set_state_machine(const struct StateMachine *machine);
+
+//leader: change the cluster by one node, false when this node is not the
+//leader or cannot start the change now, see raft_config_change()
+bool raft_add_node(unsigned short int id);
+
+bool raft_remove_node(unsigned short int id);
+
+//queue len bytes for the log, false when this node is not the leader or the
+//queue is full. cb, or an event to the calling process when cb is NULL,
+//reports the outcome, see raft_proposal.h
+bool raft_propose(const uint8_t *buf, uint8_t len, raft_propose_cb cb);
+
 
 
 bool id_compare(unsigned short int a, unsigned short int b);
 
 
 
+//print helpers, compiled out below RAFT_TRACE_DEBUG
+
+#if RAFT_TRACE_LEVEL >= RAFT_TRACE_DEBUG
+
+void raft_print(struct Raft *node);
+
 void msg_print(uint32_t currTerm, uint8_t node_id, struct Msg *msg);
 
-void heartbeat_print(struct Heartbeat *heart);
+void append_entries_print(struct AppendEntries *appendMsg);
 
 void election_print(struct Election *elect);
 
 void vote_print(struct Vote *vote);
 void response_print(struct Response *response);
+void install_snapshot_print(struct InstallSnapshot *chunk);
+void snapshot_response_print(struct SnapshotResponse *response);
 void broadcast_print(struct Msg *msg, struct Raft *node);
+void frame_print(const uint8_t *buf, uint16_t len);
+
+#else
+
+#define raft_print(node)
+#define msg_print(currTerm, node_id, msg)
+#define append_entries_print(appendMsg)
+#define election_print(elect)
+#define vote_print(vote)
+#define response_print(response)
+#define install_snapshot_print(chunk)
+#define snapshot_response_print(response)
+#define broadcast_print(msg, node)
+#define frame_print(buf, len)
+
+#endif
 
 
 void call_election(struct Raft *node);
@@ -0,0 +1,95 @@
+/******************************
+
+* Raft Configuration
+
+*******************************/
+
+#include "contiki.h"
+
+#include "raft.h"
+
+
+
+raft_bitmap_t raft_config_at(struct Raft *node, uint32_t index) {
+
+  raft_bitmap_t voters = node->snapshot.voters;
+  uint32_t i = node->log.firstIndex;
+
+  for (; i <= index && i <= node->log.lastIndex; ++i) {
+    struct LogEntry *entry = raft_log_get(&node->log, i);
+
+    if (entry->kind == raft_entry_add)
+      voters |= RAFT_BIT(entry->value);
+    else if (entry->kind == raft_entry_remove)
+      voters &= ~RAFT_BIT(entry->value);
+  }
+
+  return voters;
+
+}
+
+
+
+void raft_config_update(struct Raft *node) {
+
+  raft_bitmap_t voters = raft_config_at(node, node->log.lastIndex);
+  uint32_t i = node->log.lastIndex;
+
+  node->configIndex = 0;
+
+  for (; i >= node->log.firstIndex && i > 0; --i)
+    if (raft_log_get(&node->log, i)->kind != raft_entry_data) {
+      node->configIndex = i;
+      break;
+    }
+
+  if (voters == node->voters)
+    return;
+
+  node->voters = voters;
+
+  TRACE_INFO("CONFIGURATION: {voters: 0x%lx, index: %lu}\n", (unsigned long)voters, \
+    (unsigned long)node->configIndex);
+
+  TRACE_EVENT(trace_config, 0, node->term, node->configIndex);
+
+}
+
+
+
+int raft_config_change(struct Raft *node, uint8_t kind, unsigned short int id) {
+
+  raft_bitmap_t voters;
+
+  if (node->state != leader || id == 0 || id > RAFT_MAX_NODES)
+    return 0;
+
+  if (node->configIndex > node->commitIndex || raft_log_term(&node->log, node->commitIndex) != node->term)
+    return 0;
+
+  voters = kind == raft_entry_add ? node->voters | RAFT_BIT(id) : node->voters & ~RAFT_BIT(id);
+
+  if (voters == node->voters || voters == 0)
+    return 0;
+
+  //not the first entry of our term, so the slot kept for that stays free
+  if (raft_log_count(&node->log) >= RAFT_LOG_SIZE - 1)
+    raft_compact(node);
+  if (raft_log_count(&node->log) >= RAFT_LOG_SIZE - 1 || \
+    !raft_log_append(&node->log, node->term, kind, id))
+    return 0;
+
+  //an entry that is not on flash is neither followed nor sent
+  if (!raft_storage_append(node, node->log.lastIndex)) {
+    raft_log_truncate(&node->log, node->log.lastIndex);
+    return 0;
+  }
+
+  node->lastLogIndex = node->log.lastIndex;
+  node->lastLogTerm = node->term;
+
+  raft_config_update(node);
+
+  return 1;
+
+}
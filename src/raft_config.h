@@ -0,0 +1,40 @@
+/******************************
+
+* Raft Configuration
+
+* Cluster membership at runtime, one node at a time. A change is a log
+* entry (raft_entry_add or raft_entry_remove, the value is the node id)
+* that a node follows as soon as it is in its log, committed or not: the
+* voters mask is the snapshot's configuration with the changes in the log
+* applied in order, recomputed whenever the log changes, so a change that
+* is truncated away is undone with it. Majorities of two configurations
+* one node apart always overlap, which makes single node changes safe
+* without a joint phase as long as the leader keeps at most one of them
+* uncommitted and has committed an entry of its own term first. Nodes 1
+* ... TOTAL_NODES form the initial cluster. Ids up to RAFT_MAX_NODES can
+* join later and replicate the log without a vote until they are added.
+
+*******************************/
+
+#ifndef RAFT_CONFIG_H_
+#define RAFT_CONFIG_H_
+
+#include <stdint.h>
+
+#include "raft_quorum.h"
+
+struct Raft;
+
+//voters as of index, from the snapshot and the log entries up to index
+raft_bitmap_t raft_config_at(struct Raft *node, uint32_t index);
+
+//follow the latest configuration in the log, after anything changed the log
+void raft_config_update(struct Raft *node);
+
+//leader: append a raft_entry_add or raft_entry_remove for id, 0 while the
+//previous change is uncommitted, before an entry of our term committed,
+//when it changes nothing, would leave no voters, the log is full or the
+//entry cannot be stored
+int raft_config_change(struct Raft *node, uint8_t kind, unsigned short int id);
+
+#endif /* RAFT_CONFIG_H_ */
@@ -0,0 +1,102 @@
+/******************************
+
+* Raft Energy
+
+*******************************/
+
+#include "contiki.h"
+
+#include "sys/rtimer.h"
+
+#include "raft.h"
+
+
+
+#if RAFT_ENERGY
+
+static const uint8_t energestTypes[raft_energy_types_count] = {
+  ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM, ENERGEST_TYPE_TRANSMIT, ENERGEST_TYPE_LISTEN
+};
+
+static const char * const stateNames[RAFT_ENERGY_STATES] = {"follower", "candidate", "leader"};
+
+
+
+void raft_energy_init(struct RaftEnergy *energy, uint8_t state) {
+
+  int i = 0, s = 0;
+
+  energest_flush();
+
+  for (s = 0; s < RAFT_ENERGY_STATES; ++s)
+    for (i = 0; i < raft_energy_types_count; ++i)
+      energy->time[s][i] = 0;
+
+  for (i = 0; i < raft_energy_types_count; ++i)
+    energy->last[i] = energest_type_time(energestTypes[i]);
+
+  energy->reportRadio = 0;
+  energy->reportIndex = 0;
+  energy->state = state;
+
+}
+
+
+
+void raft_energy_charge(struct RaftEnergy *energy, uint8_t state) {
+
+  int i = 0;
+
+  energest_flush();
+
+  for (i = 0; i < raft_energy_types_count; ++i) {
+    unsigned long now = energest_type_time(energestTypes[i]);
+
+    energy->time[energy->state][i] += now - energy->last[i]; //wraps correctly
+    energy->last[i] = now;
+  }
+
+  energy->state = state;
+
+}
+
+
+
+//without overflowing 32 bits for days of ticks
+
+static unsigned long ticks_to_ms(unsigned long ticks) {
+
+  return (ticks / RTIMER_SECOND) * 1000 + (ticks % RTIMER_SECOND) * 1000 / RTIMER_SECOND;
+
+}
+
+
+
+void raft_energy_report(struct RaftEnergy *energy, uint32_t commitIndex) {
+
+  unsigned long radio = 0;
+  uint32_t committed = commitIndex - energy->reportIndex;
+  int s = 0;
+
+  raft_energy_charge(energy, energy->state);
+
+  for (s = 0; s < RAFT_ENERGY_STATES; ++s) {
+    unsigned long *t = energy->time[s];
+
+    TRACE_INFO("ENERGY %s: {cpu: %lu, lpm: %lu, transmit: %lu, listen: %lu} ms\n", stateNames[s], \
+      ticks_to_ms(t[raft_energy_cpu]), ticks_to_ms(t[raft_energy_lpm]), \
+      ticks_to_ms(t[raft_energy_transmit]), ticks_to_ms(t[raft_energy_listen]));
+
+    radio += t[raft_energy_transmit] + t[raft_energy_listen];
+  }
+
+  if (committed > 0)
+    TRACE_INFO("ENERGY PER ENTRY: {radio: %lu ms, entries: %lu}\n", \
+      ticks_to_ms((radio - energy->reportRadio) / committed), (unsigned long)committed);
+
+  energy->reportRadio = radio;
+  energy->reportIndex = commitIndex;
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/******************************
+
+* Raft Energy
+
+* Where the time goes per Raft state, from Contiki's Energest counters:
+* CPU active and in low power mode, radio transmitting and listening.
+* Every state change charges the time since the previous one to the state
+* being left, so a report shows what a follower, a candidate and a leader
+* each cost, and the radio time spent per entry committed since the last
+* report, the figure that decides battery life. Reports are printed at
+* the info trace level; without ENERGEST_CONF_ON or below that level the
+* calls expand to nothing.
+
+*******************************/
+
+#ifndef RAFT_ENERGY_H_
+#define RAFT_ENERGY_H_
+
+#include "contiki.h"
+
+#include "sys/energest.h"
+
+#include "raft_trace.h"
+
+#include <stdint.h>
+
+#ifndef RAFT_ENERGY
+#if defined(ENERGEST_CONF_ON) && RAFT_TRACE_LEVEL >= RAFT_TRACE_INFO
+#define RAFT_ENERGY ENERGEST_CONF_ON
+#else
+#define RAFT_ENERGY 0
+#endif
+#endif
+
+#ifndef RAFT_ENERGY_REPORT_MS
+#define RAFT_ENERGY_REPORT_MS 60000 //between the reports of raft_node_process
+#endif
+
+#define RAFT_ENERGY_STATES 3 //enum states of raft.h
+
+enum raft_energy_types {raft_energy_cpu, raft_energy_lpm, raft_energy_transmit, raft_energy_listen, raft_energy_types_count};
+
+struct RaftEnergy {
+
+  unsigned long time[RAFT_ENERGY_STATES][raft_energy_types_count]; //rtimer ticks charged to each state
+
+  unsigned long last[raft_energy_types_count]; //Energest totals when last charged
+
+  unsigned long reportRadio; //radio ticks of all states at the last report
+
+  uint32_t reportIndex;      //commit index at the last report
+
+  uint8_t state;             //being charged now
+
+};
+
+#if RAFT_ENERGY
+
+void raft_energy_init(struct RaftEnergy *energy, uint8_t state);
+
+//charge the time since the last call to the current state, then switch to state
+void raft_energy_charge(struct RaftEnergy *energy, uint8_t state);
+
+//prints the time per state and the radio time per entry committed since the last report
+void raft_energy_report(struct RaftEnergy *energy, uint32_t commitIndex);
+
+#else
+
+#define raft_energy_init(energy, state)
+
+#define raft_energy_charge(energy, state)
+
+#define raft_energy_report(energy, commitIndex)
+
+#endif
+
+#endif /* RAFT_ENERGY_H_ */
@@ -0,0 +1,120 @@
+/******************************
+
+* Raft Log
+
+*******************************/
+
+#include "raft_log.h"
+
+
+#define SLOT(index) ((index) % RAFT_LOG_SIZE)
+
+
+
+void raft_log_init(struct RaftLog *log) {
+
+  log->firstIndex = 1;
+
+  log->lastIndex = 0;
+
+  log->baseTerm = 0;
+
+}
+
+
+
+int raft_log_append(struct RaftLog *log, uint32_t term, uint8_t kind, uint8_t value) {
+
+  struct LogEntry *entry;
+
+  if (raft_log_full(log))
+    return 0;
+
+  ++log->lastIndex;
+
+  entry = &log->entries[SLOT(log->lastIndex)];
+  entry->term = term;
+  entry->kind = kind;
+  entry->value = value;
+
+  return 1;
+
+}
+
+
+
+struct LogEntry *raft_log_get(struct RaftLog *log, uint32_t index) {
+
+  if (index < log->firstIndex || index > log->lastIndex)
+    return 0;
+
+  return &log->entries[SLOT(index)];
+
+}
+
+
+
+uint32_t raft_log_term(struct RaftLog *log, uint32_t index) {
+
+  if (index == log->firstIndex - 1)
+    return log->baseTerm;
+
+  if (index < log->firstIndex || index > log->lastIndex)
+    return 0;
+
+  return log->entries[SLOT(index)].term;
+
+}
+
+
+
+void raft_log_truncate(struct RaftLog *log, uint32_t index) {
+
+  if (index < log->firstIndex)
+    index = log->firstIndex;
+
+  if (index <= log->lastIndex)
+    log->lastIndex = index - 1;
+
+}
+
+
+
+void raft_log_discard(struct RaftLog *log, uint32_t index) {
+
+  if (index < log->firstIndex || index > log->lastIndex)
+    return;
+
+  log->baseTerm = log->entries[SLOT(index)].term;
+
+  log->firstIndex = index + 1;
+
+}
+
+
+
+void raft_log_reset(struct RaftLog *log, uint32_t index, uint32_t term) {
+
+  log->firstIndex = index + 1;
+
+  log->lastIndex = index;
+
+  log->baseTerm = term;
+
+}
+
+
+
+uint32_t raft_log_count(struct RaftLog *log) {
+
+  return log->lastIndex + 1 - log->firstIndex;
+
+}
+
+
+
+int raft_log_full(struct RaftLog *log) {
+
+  return raft_log_count(log) >= RAFT_LOG_SIZE;
+
+}
@@ -0,0 +1,74 @@
+/******************************
+
+* Raft Log
+
+* Ring buffer log store. Entries are addressed by 32-bit logical indices
+* (1, 2, 3, ... forever) mapped onto a fixed number of physical slots, so
+* a node can keep replicating indefinitely in a fixed RAM budget as long
+* as it discards the committed prefix.
+
+*******************************/
+
+#ifndef RAFT_LOG_H_
+#define RAFT_LOG_H_
+
+#include <stdint.h>
+
+#ifndef RAFT_LOG_SIZE
+#define RAFT_LOG_SIZE 32 //physical slots, a power of two keeps the slot math a mask
+#endif
+
+//what an entry's value means
+enum raft_entry_kinds {
+  raft_entry_data,   //a byte for the state machine
+  raft_entry_add,    //id of a node joining the cluster
+  raft_entry_remove  //id of a node leaving it
+};
+
+struct LogEntry {
+
+  uint32_t term;
+
+  uint8_t kind;  //enum raft_entry_kinds
+
+  uint8_t value;
+
+};
+
+struct RaftLog {
+
+  struct LogEntry entries[RAFT_LOG_SIZE];
+
+  uint32_t firstIndex; //oldest retained entry
+
+  uint32_t lastIndex;  //newest entry, firstIndex - 1 when empty
+
+  uint32_t baseTerm;   //term of entry firstIndex - 1 (discarded or never written)
+
+};
+
+void raft_log_init(struct RaftLog *log);
+
+//returns 0 when every slot is taken, discard the committed prefix first
+int raft_log_append(struct RaftLog *log, uint32_t term, uint8_t kind, uint8_t value);
+
+//NULL when index is discarded or not written yet
+struct LogEntry *raft_log_get(struct RaftLog *log, uint32_t index);
+
+//term of the entry at index, baseTerm for firstIndex - 1, 0 when unknown
+uint32_t raft_log_term(struct RaftLog *log, uint32_t index);
+
+//drop index and everything after it
+void raft_log_truncate(struct RaftLog *log, uint32_t index);
+
+//drop everything up to and including index (usually commitIndex)
+void raft_log_discard(struct RaftLog *log, uint32_t index);
+
+//empty the log so the next append gets index + 1, used after installing a snapshot
+void raft_log_reset(struct RaftLog *log, uint32_t index, uint32_t term);
+
+uint32_t raft_log_count(struct RaftLog *log);
+
+int raft_log_full(struct RaftLog *log);
+
+#endif /* RAFT_LOG_H_ */
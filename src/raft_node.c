@@ -37,6 +37,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #define BROADCAST_CHANNEL          7      // Channel used for broadcast data transfer
@@ -53,563 +54,379 @@ static void timeout_callback(void *ptr);
 
 bool init = false;
 
-static struct Vote voteMsg;
-
-static struct Response responseMsg;
-
+static void raft_recv(const linkaddr_t *from, uint8_t toAll);
 
 static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from);
-//static void unicast_recv(struct unicast_conn *c, const linkaddr_t *from);
+static void unicast_recv(struct unicast_conn *c, const linkaddr_t *from);
 
 
 //static struct simple_udp_connection broadcast_connection;
 //for leader & candidate
 static const struct broadcast_callbacks broadcast_call = {broadcast_recv}; //go to receiver function to execute, function pointer
 
-//for follower
-//static const struct unicast_callbacks unicast_callbacks = {broadcast_recv};
+//votes, acks, repairs and snapshot chunks, only the addressed node hears them
+static const struct unicast_callbacks unicast_callbacks = {unicast_recv};
 static struct broadcast_conn broadcast;
-//static struct unicast_conn unicast;
-
-//uip_ipaddr_t addr;
-
-
-
-/*---------------------------------------------------------------------------*/
-
-PROCESS(raft_node_process, "Broadcast and unicast raft node process");
-//PROCESS(simple_comm_process, "Simple communication process");
-//PROCESS(unicast_process, "unicast process");
-//PROCESS(unicast_process, "unicast process");
-
-AUTOSTART_PROCESSES(&raft_node_process);
-
-/*---------------------------------------------------------------------------*/
-
-static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from) {
-
-  //printf("\nGOT MESSAGE\n");
-
-  struct Msg *msg = (struct Msg *)packetbuf_dataptr();
-  broadcast_print(msg,&node);
-
-
-  switch (node.state) {
-
-    case follower:
-
-      {
-
-        //election
-
-        if (msg->type == election) {
-          struct Election *elect = (struct Election *)packetbuf_dataptr();
-          //memcpy(elect, packetbuf_dataptr(), sizeof(struct Election));
-
-           //if Election, change
-          //the type and format of message to Election. this casts the type of message (type cast).
-          //memcpy(elect, packetbuf_dataptr(), sizeof(struct Election));
-          printf("ELECTION BROADCAST MESSAGE RECEIVED BY FOLLLOWER \n");
-
-          election_print(elect);
-
-
-
-          //reset timer
-
-          ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL);
-
-
-
-          //build vote msg
-
-          //static struct Vote voteMsg;
-
-          
+static struct unicast_conn unicast;
 
+static uint8_t *frame_begin(void);
 
+static void frame_end(unsigned short int to, uint16_t len, clock_time_t delay);
 
-	       unsigned short int nullAddr = 0;
+//the step encodes its frames into packetbuf through these
+static const struct RaftSink sink = {frame_begin, frame_end};
 
-         if (msg->term >= node.term){
-            node.term = msg->term;
-            build_vote(&voteMsg, node.term, node.id, 0, false);
+#if RAFT_ACK_SLOT_MS
+//an ack waiting for its slot, the one copy of a frame this file keeps.
+//Acks are cumulative, so a newer one simply replaces it and keeps its slot
+static uint8_t heldData[RAFT_MAX_PAYLOAD];
 
+static uint16_t heldLen;
 
+static unsigned short int heldTo;
 
-            if (id_compare(nullAddr, node.votedFor) && ((elect->lastLogTerm > node.prevLogTerm) || ((elect->lastLogIndex >= node.prevLogIndex) && \
-            (elect->lastLogTerm == node.prevLogTerm)))) { //vote has not been used
+static struct ctimer heldTimer;
+#endif
 
-                voteMsg.voteFor = elect->from;
-                voteMsg.voteGranted = true;
-
-                printf("VOTE GRANTED! \t");
-                printf("voteFor: %d \n", voteMsg.voteFor);
-                
-              }
-          }
-
-            //update node.votedFor to sender_addr
-
-            /*
-
-            for (i = 0; i < 8; ++i) {
-
-              printf("%d", elect->from[i]);
-
-              node.votedFor[i] = elect->from[i];
-
-              voteMsg.voteFor[i] = elect->from[i];*/
-
-            
-
-              //printf("\n");}
-
-            //voteGranted = true already set
-
-          
+//uip_ipaddr_t addr;
 
-          else { //vote was used this term
-              build_vote(&voteMsg, node.term, node.id, 0, false);
-              printf("VOTE NOT GRANTED \n");
 
-              //voteMsg.voteGranted = false;
-          }
-        
-        linkaddr_t bufferId = {{elect->from}};
 
-        packetbuf_copyfrom(&voteMsg, sizeof(voteMsg));
-        packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &(bufferId));
-    
-        //broadcast_send(&broadcast);
-        broadcast_send(&broadcast); //check what is const union linkaddr_t, seems like only unicast has this issue
-        printf("VOTE UNICAST MESSAGE SENT TO CANDIDATE\n");
-        vote_print(&voteMsg);
-        }
+/*---------------------------------------------------------------------------*/
 
-        //heartbeat
+PROCESS(raft_node_process, "Broadcast and unicast raft node process");
+PROCESS(raft_apply_process, "Raft apply process");
+PROCESS(raft_client_process, "Raft demo client process");
+//PROCESS(simple_comm_process, "Simple communication process");
+//PROCESS(unicast_process, "unicast process");
+//PROCESS(unicast_process, "unicast process");
 
-	else if (msg->type == heartbeat) {
+AUTOSTART_PROCESSES(&raft_node_process, &raft_apply_process, &raft_client_process);
 
-		struct Heartbeat *heart = (struct Heartbeat *)packetbuf_dataptr();
-    
-    //memcpy(heart, packetbuf_dataptr(), sizeof(struct Heartbeat));
-    printf("HEARTBEAT BROADCAST RECEIVED BY FOLLOWER \n");
-		heartbeat_print(heart);
+/*---------------------------------------------------------------------------*/
 
-		//reset timer
+//restart the election timer with a freshly drawn timeout
 
-		ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL);
-    node.votedFor = 0;
+static void reset_timeout(void) {
 
-    
-    if (msg->term >= node.term){
-        node.term = msg->term;
-        node.currentTerm = msg->term;
-      }
+  ctimer_set(&nodeTimeout, raft_timer_draw(&node.timer), &timeout_callback, NULL);
 
-    bool logOK = ((heart->prevLogIndex >= node.prevLogIndex) && \
-      (msg->term >= node.prevLogTerm));
+}
 
-    if ((msg->term == node.term) && logOK) {
-        printf("HEARTBEAT VALUE ACCEPTED BY FOLLOWER \n");
+//broadcast or unicast by address what packetbuf holds
 
-        //to insert check for similarity of last entry. requires heartbeat log, rather than heartbeat value.
-        node.log[heart->nextIndex] = heart->value;
+static void send_frame(unsigned short int to) {
 
-        node.prevLogTerm = msg->term;
-        node.prevLogIndex = heart->nextIndex;
-        node.leaderCommit = heart->leaderCommit;
+  if (to == 0)
+    broadcast_send(&broadcast);
+  else {
+    linkaddr_t bufferId = {{to}};
+    unicast_send(&unicast, &(bufferId));
+  }
 
-        
-        build_response(&responseMsg, node.commitIndex, node.currentTerm, node.id, \
-          node.prevLogIndex, node.prevLogTerm, true);
+}
 
-        linkaddr_t bufferId = {{heart->from}};
-        //struct unicast_conn *c = (struct unicast_conn *)broadcast;
-        packetbuf_copyfrom(&responseMsg, sizeof(responseMsg));
-        packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &(bufferId));
+#if RAFT_ACK_SLOT_MS
+static void held_callback(void *ptr) {
 
-        printf("ACK UNICAST SENT BY FOLLOWER TO LEADER\n");
-        response_print(&responseMsg);
-        //broadcast_send(&broadcast);
-        broadcast_send(&broadcast); 
-    }
-    
-		else {
-        build_response(&responseMsg, node.commitIndex, node.currentTerm, node.id, \
-          node.prevLogIndex, node.prevLogTerm, false);
+  (void)ptr;
 
-        linkaddr_t bufferId = {{heart->from}};
-        //struct unicast_conn *c = (struct unicast_conn *)broadcast;
-        packetbuf_copyfrom(&responseMsg, sizeof(responseMsg));
-        packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &(bufferId));
+  packetbuf_copyfrom(heldData, heldLen);
 
-        printf("NACK UNICAST SENT BY FOLLOWER TO LEADER\n");
-        response_print(&responseMsg);
-        //broadcast_send(&broadcast);
-        broadcast_send(&broadcast); 
+  send_frame(heldTo);
 
-    }
+}
+#endif
 
-      }}
+//frames are encoded straight into packetbuf: frame_begin() hands the step
+//its data area and frame_end() sends what it wrote, or holds it for its slot
 
-    case candidate:
+static uint8_t *frame_begin(void) {
 
-      {//vote response
+  packetbuf_clear();
 
-        if (msg->type == vote) {
+  return (uint8_t *)packetbuf_dataptr();
 
-         ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL);
+}
 
-          struct Vote *vote = (struct Vote *)packetbuf_dataptr(); // use memcpy for variable, use typecast for pointer (like here)
+static void frame_end(unsigned short int to, uint16_t len, clock_time_t delay) {
 
+  (void)delay;
 
-          printf("VOTE UNICAST MESSAGE RECEIVED BY CANDIDATE \n");
-          vote_print(vote);
+  packetbuf_set_datalen(len);
 
+  frame_print((const uint8_t *)packetbuf_dataptr(), len);
 
+#if RAFT_ACK_SLOT_MS
+  if (delay > 0) {
+    memcpy(heldData, packetbuf_dataptr(), len);
+    heldLen = len;
+    heldTo = to;
+    //keep the earliest deadline, restarting it for every broadcast would
+    //hold the ack for good whenever they come faster than its slot
+    if (ctimer_expired(&heldTimer))
+      ctimer_set(&heldTimer, delay, &held_callback, NULL);
+    return;
+  }
+#endif
 
-          //vote is for this node
+  send_frame(to);
 
-          if (id_compare(vote->voteFor, node.id) && vote->voteGranted) {
-            //how to check idempotency? will require a set with contains function
+}
 
-            if (!is_set_member(&node, vote->from)){
-                insert_set_member(&node, vote->from);
+//run one event through raft_step(), which sends its frames as it goes, and
+//carry out the rest of its outputs: the timer and the apply process.
+//Nothing else in this file knows the protocol
 
-            //increment vote count
-                printf("+1 VOTE \n");
+static void step(uint8_t type, const linkaddr_t *from, uint8_t toAll) {
 
-                ++node.totalVotes;
+  struct RaftEvent event;
+  struct RaftOutputs outputs;
 
-                if (node.totalVotes > (TOTAL_NODES + 1/ 2)) { //if vote count is majority, change to leader & send heartbeat
-                  printf("QUORUM MET, SET NODE AS LEADER \n");
+  event.type = type;
+  event.now = clock_time();
+  event.buf = (const uint8_t *)packetbuf_dataptr();
+  event.len = type == raft_step_frame ? packetbuf_datalen() : 0;
+  event.from = from != NULL ? from->u8[0] : 0;
+  event.broadcast = toAll;
 
-                  raft_set_leader(&node);
+  outputs.sink = &sink;
 
-                 
+  raft_step(&node, &event, &outputs);
 
-                  static struct Heartbeat heart;
+  if (outputs.resetTimeout)
+    reset_timeout();
 
-                  build_heartbeat(&heart, node.term, node.id, node.prevLogIndex, 
-                    node.prevLogTerm, node.nextIndex,
-                    1, node.leaderCommit); 
+  if (outputs.apply)
+    process_poll(&raft_apply_process);
 
+}
 
-                  packetbuf_copyfrom(&heart, sizeof(heart));
-                  printf("HEARTBEAT BROADCAST SENT AFTER BEING ELECTED LEADER \n");
-                  heartbeat_print(&heart);
+/*---------------------------------------------------------------------------*/
 
-                  broadcast_send(&broadcast);
-                  }
+static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from) {
 
-            }
+  raft_recv(from, 1);
 
-            else {
-              printf("RECEIVED DUPLICATE VOTE \n");
+}
 
-            }
+static void unicast_recv(struct unicast_conn *c, const linkaddr_t *from) {
 
-            //ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL); //should have time out at the start and intermittently when receiving new messages?
+  raft_recv(from, 0);
 
-          }
+}
 
-          else if (id_compare(vote->voteFor, node.id) && !vote->voteGranted) {
-            printf("VOTE NOT GRANTED UNICAST MESSAGE RECEIVED BY CANDIDATE \n");
-            vote_print(vote); 
-            printf("SETTING CANDIDATE AS FOLLOWER \n");    
-            raft_set_follower(&node);
-       
+//both connections end up here, the core dispatches on state and message type
 
-          }
+static void raft_recv(const linkaddr_t *from, uint8_t toAll) {
 
-        }
+  step(raft_step_frame, from, toAll);
 
-       else if (msg->type == heartbeat) {
+}
 
-           raft_set_follower(&node);
+static void timeout_callback(void *ptr) {
 
-       }
+  step(raft_step_timeout, NULL, 0);
 
-       else if (msg->type == election && msg->term > node.term){
+}
 
-            node.term = msg->term;
-            node.currentTerm = msg->term;
-            raft_set_follower(&node);
 
-       }
 
-      }
-    
-  case leader:
-    {
-      if (msg->type == respond){
+/*---------------------------------------------------------------------------*/
 
-              struct Response *response = (struct Response *)packetbuf_dataptr();
-              //heartbeat_print(heart);
-              //vote_print(vote); to include response_print function in raft.c
-              printf("RESPONSE UNICAST MESSAGE RECEIVED BY LEADER\n");
+PROCESS_THREAD(raft_node_process, ev, data) {
 
+  static struct etimer leaderTimer;
 
-          /*if (responseMsg.currentTerm == heart.term && 
-            responseMsg.commitIndex == heart.nextIndex &&
-            responseMsg.valueCheck == heart.value) */
-          if (msg->term == node.currentTerm){
-            if (response->success){
+  static struct timer energyTimer;
 
-              ++node.totalCommits;
-              if (node.totalCommits >= (TOTAL_NODES/2)) {     
 
-                node.leaderCommit = responseMsg.prevLogIndex; 
+  PROCESS_EXITHANDLER(broadcast_close(&broadcast); unicast_close(&unicast);)
+  PROCESS_BEGIN();
 
-                node.totalCommits = 0;
-                printf("Commited to index: %d \n", node.leaderCommit);
 
-              }   
-            }
-          }
 
-          else if (msg->term > node.currentTerm) {
-            node.term = msg->term;
-            node.currentTerm = msg->term;
-            raft_set_follower(&node);
+  TRACE_INFO("--BROADCAST RAFT NODE PROCESS BEGIN--\n");
 
-          }
-      
-      /*
 
-      ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL);  
 
-      
+  if (!init) {
 
-      static struct Heartbeat heart;
+    raft_init(&node);
 
-      build_heartbeat(&heart, node.term, node.id, node.prevLogIndex, node.prevLogTerm, 
-        node.nextIndex,
-        1, node.leaderCommit); 
-        
-        packetbuf_copyfrom(&heart, sizeof(heart));
-        broadcast_send(&broadcast);
+    init = true;
 
+  }
 
-      printf("LEADER SENDING BROADCAST HEARTBEAT TO ALL (IN BROADCAST_RECV)\n");
 
-      heartbeat_print(&heart);
-     
+  broadcast_open(&broadcast, BROADCAST_CHANNEL, &broadcast_call);
+  unicast_open(&unicast, UNICAST_CHANNEL, &unicast_callbacks);
+  raft_print(&node);
 
-      
-      if (msg->type == heartbeat && !id_compare(msg->from, node.id) && msg->term >= node.prevLogTerm \
-        && heart.prevLogIndex >= node.prevLogIndex) {
-        struct Heartbeat *heart = (struct Heartbeat *)packetbuf_dataptr();
 
-      printf("HEART BROADCAST MESSAGE RECEIVED BY LEADER. SWITCHING TO FOLLOWER.\n");
-        //heartbeat_print(heart);
 
-         raft_set_follower(&node);
-       }
-      
+  reset_timeout();
 
-      if (msg->type == respond){
+  timer_set(&energyTimer, RAFT_MS_TO_TICKS(RAFT_ENERGY_REPORT_MS));
 
-              struct Response *response = (struct Response *)packetbuf_dataptr();
-              //heartbeat_print(heart);
-              //vote_print(vote); to include response_print function in raft.c
-              printf("RESPONSE UNICAST MESSAGE RECEIVED BY LEADER\n");
 
-          if (responseMsg.currentTerm == heart.term && 
-            responseMsg.commitIndex == heart.nextIndex &&
-            responseMsg.valueCheck == heart.value) {
 
-             ++node.totalCommits;
+  /*simple_udp_register(&broadcast_connection, UDP_PORT,
 
-                  
+                      NULL, UDP_PORT,
 
-              if (node.totalCommits >= (TOTAL_NODES/2)) {     
+                      receiver);*/
 
-              node.leaderCommit = responseMsg.prevLogIndex; 
 
-              node.totalCommits = 0;
-              printf("Commited to index: %d \n", node.leaderCommit);
 
-              }   
-          }
+  while(1) {
 
-          else if (responseMsg.commitIndex < heart.nextIndex){
-            int patch = 0;
-            patch = responseMsg.commitIndex;
+    etimer_set(&leaderTimer, RAFT_BEAT_TICKS(node.idle));
 
+    //raft_propose() polls to cut a stretched interval short
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&leaderTimer) || ev == PROCESS_EVENT_POLL);
 
-            for (patch; patch < responseMsg.commitIndex; patch ++){
-              build_heartbeat(&heart, node.term, node.id, 
-                node.prevLogIndex, node.prevLogTerm, node.nextIndex,
-                 node.log[patch], node.leaderCommit);
+    if (timer_expired(&energyTimer)) {
+      raft_energy_report(&node.energy, node.commitIndex);
+      timer_reset(&energyTimer);
+    }
 
-              //to substitute w code that allows one to one sending.
-              linkaddr_t bufferId = {{msg->from}};
-              packetbuf_copyfrom(&heart, sizeof(heart));
-              packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &(bufferId));
-            
-                //broadcast_send(&broadcast);
-              broadcast_send(&broadcast); 
-              //broadcast_send(&broadcast);
-              //unicast_send(&unicast, &(bufferId)); //check what is const union linkaddr_t, seems like only unicast has this issue
-              //uip_create_linklocal_allnodes_mcast(&addr);
-              //simple_udp_sendto(&broadcast_connection, &heart, sizeof(heart), &addr);
-              }
+    //the leader flushes proposals and heartbeats, nobody else does anything
 
+    step(raft_step_heartbeat, NULL, 0);
 
 
-          }
 
-    node.prevLogIndex+=1;
+    //uip_create_linklocal_allnodes_mcast(&addr);
 
-    break;
+    //simple_udp_sendto(&broadcast_connection, &heart, sizeof(heart), &addr);
 
+  }
 
-        } */
 
 
-  
+  PROCESS_END();
 
-    } 
-}}}
+}
 
 /*---------------------------------------------------------------------------*/
 
-static void timeout_callback(void *ptr) {
-
-  printf("\nTIMEOUT CALLBACK\n");
+//committed entries are applied here rather than in the receive callbacks,
+//a batch at a time so frames and timers are serviced in between
 
-  if ((node.state == follower) || (node.state == candidate)) {
+PROCESS_THREAD(raft_apply_process, ev, data) {
 
-    printf("MSG TIMEOUT, STARTING ELECTION\n");
-
-    node.term+=1;
-    init_set(&node);
-
-    printf("+1 NODE TERM\n");
-    raft_set_candidate(&node);
-
-
-
-
-    //send election
-
-    static struct Election elect;
-
-    build_election(&elect, node.term, node.id, node.lastLogTerm, node.lastLogIndex); 
-
-    packetbuf_copyfrom(&elect, sizeof(elect));
-    broadcast_send(&broadcast);\
+  PROCESS_BEGIN();
 
-    printf("IN TIMEOUT CALLBACK, LEADER SENDING ELECTION BROADCAST REQUEST TO ALL\n");
+  while(1) {
 
-    election_print(&elect);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
 
-\
-    //uip_create_linklocal_allnodes_mcast(&addr);
-
-    //simple_udp_sendto(&broadcast_connection, &elect, sizeof(elect), &addr);
+    if (raft_apply(&node, RAFT_APPLY_BATCH))
+      process_poll(&raft_apply_process);
 
   }
 
-  else if (node.state == leader) {} //log stuff later on
-
-
-
-  ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL);
+  PROCESS_END();
 
 }
 
-
-
 /*---------------------------------------------------------------------------*/
 
-PROCESS_THREAD(raft_node_process, ev, data) {
-
-  static struct etimer leaderTimer;
-
-
-  PROCESS_EXITHANDLER(broadcast_close(&broadcast);)
-  PROCESS_BEGIN();
-
+void raft_set_state_machine(const struct StateMachine *machine) {
 
+  node.stateMachine = machine;
 
-  printf("--BROADCAST RAFT NODE PROCESS BEGIN--\n");
+  //before raft_init, it restores the snapshot into this machine itself
+  if (!init)
+    return;
 
+  if (node.snapshot.len > 0)
+    machine->restore(node.snapshot.data, node.snapshot.len);
+  node.lastApplied = node.snapshot.lastIndex;
 
+  process_poll(&raft_apply_process);
 
-  if (!init) {
-
-    raft_init(&node);
-
-    init = true;
-
-  }
+}
 
+/*---------------------------------------------------------------------------*/
 
-  broadcast_open(&broadcast, BROADCAST_CHANNEL, &broadcast_call);
-  //unicast_open(&unicast, UNICAST_CHANNEL, &unicast_callbacks);
-  raft_print(&node);
+bool raft_add_node(unsigned short int id) {
 
+  return raft_config_change(&node, raft_entry_add, id) ? true : false;
 
+}
 
-  ctimer_set(&nodeTimeout, node.timeout * CLOCK_SECOND, &timeout_callback, NULL);
+/*---------------------------------------------------------------------------*/
 
+bool raft_remove_node(unsigned short int id) {
 
+  return raft_config_change(&node, raft_entry_remove, id) ? true : false;
 
-  /*simple_udp_register(&broadcast_connection, UDP_PORT,
+}
 
-                      NULL, UDP_PORT,
+/*---------------------------------------------------------------------------*/
 
-                      receiver);*/
+bool raft_propose(const uint8_t *buf, uint8_t len, raft_propose_cb cb) {
 
+  if (node.state != leader)
+    return false;
 
+  if (!raft_proposal_push(&node.proposals, buf, len, cb, PROCESS_CURRENT()))
+    return false;
 
-  while(1) {
+  //an idle leader would sit on it for up to RAFT_BEAT_TICKS(RAFT_IDLE_SHIFT)
+  if (node.idle > 0)
+    process_poll(&raft_node_process);
 
-    etimer_set(&leaderTimer, LEADER_SEND_INTERVAL * CLOCK_SECOND);
+  return true;
 
-    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&leaderTimer));
+}
 
-    if (node.state == leader) {
+/*---------------------------------------------------------------------------*/
 
-      //send heartbeat 
+//stands in for an application: while this node leads it proposes the value
+//1 every RAFT_CLIENT_INTERVAL_MS and hears back through events
 
-      static struct Heartbeat heart;
-      node.prevLogTerm = node.term;
-      node.prevLogIndex = node.nextIndex;
-      node.nextIndex++;
+PROCESS_THREAD(raft_client_process, ev, data) {
 
-      build_heartbeat(&heart, node.term, node.id, node.prevLogIndex,  node.prevLogTerm, 
-        node.nextIndex,
-        1, node.leaderCommit); 
+  static struct etimer clientTimer;
 
+  static const uint8_t value = 1;
 
+  PROCESS_BEGIN();
 
-      printf("LEADER SENDING BROADCAST HEARTBEAT (WHILE LOOP)\n");
+  //0 leaves proposing to someone else, the simulator's benchmark for one
+  if (RAFT_CLIENT_INTERVAL_MS == 0)
+    PROCESS_EXIT();
 
-      heartbeat_print(&heart);
+  etimer_set(&clientTimer, RAFT_MS_TO_TICKS(RAFT_CLIENT_INTERVAL_MS));
 
-      packetbuf_copyfrom(&heart, sizeof(heart));
-      broadcast_send(&broadcast);
+  while(1) {
 
+    PROCESS_WAIT_EVENT();
 
+    if (ev == raft_event_committed) {
+      TRACE_DEBUG("CLIENT PROPOSAL COMMITTED\n");
+    }
 
-      //uip_create_linklocal_allnodes_mcast(&addr);
+    else if (ev == raft_event_failed) {
+      TRACE_INFO("CLIENT PROPOSAL FAILED\n");
+    }
 
-      //simple_udp_sendto(&broadcast_connection, &heart, sizeof(heart), &addr);
+    else if (ev == raft_event_unknown) {
+      TRACE_INFO("CLIENT PROPOSAL OUTCOME UNKNOWN\n");
+    }
 
+    else if (ev == PROCESS_EVENT_TIMER && data == &clientTimer) {
+      raft_propose(&value, 1, NULL);
+      etimer_reset(&clientTimer);
     }
 
   }
 
-
-
   PROCESS_END();
 
 }
 
 /*---------------------------------------------------------------------------*/
-
@@ -0,0 +1,206 @@
+/******************************
+
+* Raft Proposals
+
+*******************************/
+
+#include "contiki.h"
+
+#include "raft.h"
+
+
+
+#include <string.h>
+
+
+
+process_event_t raft_event_committed;
+
+process_event_t raft_event_failed;
+
+process_event_t raft_event_unknown;
+
+
+
+#define SLOT(queue, i) (&(queue)->slots[((queue)->head + (i)) % RAFT_PROPOSAL_QUEUE])
+
+
+
+void raft_proposal_init(struct ProposalQueue *queue) {
+
+  queue->head = 0;
+  queue->count = 0;
+  queue->appended = 0;
+
+  raft_event_committed = process_alloc_event();
+  raft_event_failed = process_alloc_event();
+  raft_event_unknown = process_alloc_event();
+
+}
+
+
+
+int raft_proposal_push(struct ProposalQueue *queue, const uint8_t *buf, uint8_t len, \
+  raft_propose_cb cb, struct process *process) {
+
+  struct Proposal *p;
+
+  if (len == 0 || len > RAFT_PROPOSAL_SIZE || queue->count == RAFT_PROPOSAL_QUEUE)
+    return 0;
+
+  p = SLOT(queue, queue->count);
+
+  p->buf = buf;
+  p->cb = cb;
+  p->process = process;
+  p->index = 0;
+  p->term = 0;
+  p->len = len;
+  memcpy(p->data, buf, len);
+
+  ++queue->count;
+
+  return 1;
+
+}
+
+
+
+static void report(struct Proposal *p, int committed) {
+
+  if (p->cb != NULL)
+    p->cb(p->buf, p->index, committed);
+  else if (p->process != NULL)
+    process_post(p->process, committed > 0 ? raft_event_committed : \
+      committed == 0 ? raft_event_failed : raft_event_unknown, (process_data_t)p->buf);
+
+}
+
+//free the oldest slot before reporting, the proposer may propose again from its callback
+
+static void complete(struct ProposalQueue *queue, int committed) {
+
+  struct Proposal *p = SLOT(queue, 0);
+
+  queue->head = (queue->head + 1) % RAFT_PROPOSAL_QUEUE;
+  --queue->count;
+  --queue->appended;
+
+  report(p, committed);
+
+}
+
+
+
+//the last free slot stays reserved for the first entry of a new term, as
+//entries inherited from an older leader only commit once one of ours does
+
+static int fits(struct Raft *node, uint8_t len) {
+
+  return raft_log_count(&node->log) + len <= \
+    RAFT_LOG_SIZE - (node->lastLogTerm == node->term ? 1 : 0);
+
+}
+
+
+
+uint32_t raft_proposal_flush(struct Raft *node) {
+
+  struct ProposalQueue *queue = &node->proposals;
+  uint32_t first = node->log.lastIndex + 1;
+  uint32_t appended = 0;
+  uint8_t before;
+
+  //a proposal from an earlier term of ours may have been overwritten meanwhile
+  raft_proposal_settle(queue, &node->log, node->lastApplied);
+
+  before = queue->appended;
+
+  while (queue->appended < queue->count) {
+    struct Proposal *p = SLOT(queue, queue->appended);
+    uint8_t i;
+
+    if (!fits(node, p->len))
+      raft_compact(node);
+    if (!fits(node, p->len))
+      break;
+
+    for (i = 0; i < p->len; ++i)
+      raft_log_append(&node->log, node->term, raft_entry_data, p->data[i]);
+
+    p->index = node->log.lastIndex;
+    p->term = node->term;
+    node->lastLogIndex = node->log.lastIndex;
+    node->lastLogTerm = node->term;
+
+    ++queue->appended;
+    appended += p->len;
+  }
+
+  //like a follower that refuses the ack, the leader must not count or
+  //send entries it could not persist: take them back and fail them along
+  //with everything still waiting, the flash will not take those either
+  if (appended > 0 && !raft_storage_append(node, first)) {
+    raft_log_truncate(&node->log, first);
+    node->lastLogIndex = node->log.lastIndex;
+    node->lastLogTerm = raft_log_term(&node->log, node->lastLogIndex);
+
+    for (; queue->appended > before; --queue->appended) {
+      SLOT(queue, queue->appended - 1)->index = 0;
+      SLOT(queue, queue->appended - 1)->term = 0;
+    }
+
+    raft_proposal_drop(queue);
+
+    return 0;
+  }
+
+  return appended;
+
+}
+
+
+
+void raft_proposal_settle(struct ProposalQueue *queue, struct RaftLog *log, uint32_t lastApplied) {
+
+  uint32_t base = raft_log_term(log, log->firstIndex - 1);
+
+  while (queue->appended > 0) {
+    struct Proposal *p = SLOT(queue, 0);
+    int ours;
+
+    //compaction or an installed snapshot dropped it before we got here.
+    //Only we appended entries of our term, so the snapshot's last entry
+    //being of our term makes everything of ours before it committed, and
+    //an older one means ours were overwritten. A later one tells nothing
+    if (p->index < log->firstIndex - 1) {
+      complete(queue, base == p->term ? 1 : base < p->term ? 0 : RAFT_PROPOSAL_UNKNOWN);
+      continue;
+    }
+
+    //the term of an entry that is still in the log is known
+    ours = raft_log_term(log, p->index) == p->term;
+
+    if (p->index <= lastApplied)
+      complete(queue, ours);
+    else if (!ours)
+      complete(queue, 0);
+    else
+      break;
+  }
+
+}
+
+
+
+void raft_proposal_drop(struct ProposalQueue *queue) {
+
+  uint8_t count = queue->count;
+  uint8_t i = queue->appended;
+
+  queue->count = queue->appended;
+
+  for (; i < count; ++i)
+    report(SLOT(queue, i), 0);
+
+}
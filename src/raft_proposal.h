@@ -0,0 +1,103 @@
+/******************************
+
+* Raft Proposals
+
+* Client side of the log. raft_propose() copies a proposal into a small
+* ring and returns; the leader appends every queued proposal that fits
+* into its log right before the next AppendEntries broadcast, so the
+* proposals made between two heartbeats share one frame and one flash
+* write. Each byte of a proposal is one entry of the byte wide state
+* machine. Once its last entry is committed and applied the proposer is
+* told the outcome through its callback or, when it gave none, by a
+* raft_event_committed, raft_event_failed or raft_event_unknown event
+* posted to the process that proposed, with the buf it proposed from as
+* data.
+
+*******************************/
+
+#ifndef RAFT_PROPOSAL_H_
+#define RAFT_PROPOSAL_H_
+
+#include "contiki.h"
+
+#include <stdint.h>
+
+#ifndef RAFT_PROPOSAL_QUEUE
+#define RAFT_PROPOSAL_QUEUE 8 //proposals queued or appended and not committed yet
+#endif
+
+#ifndef RAFT_PROPOSAL_SIZE
+#define RAFT_PROPOSAL_SIZE 8 //bytes, and so log entries, in one proposal
+#endif
+
+struct Raft;
+
+struct RaftLog;
+
+//committed is 1 when the entries were committed. It is 0 when they were
+//overwritten by another leader or never stored, the proposal may be
+//retried. It is RAFT_PROPOSAL_UNKNOWN when they were compacted into a
+//snapshot of a later term before they could be checked: they may have
+//been committed, so a retry may apply them twice. buf is the pointer given
+//to raft_propose, its contents may have changed since
+typedef void (* raft_propose_cb)(const uint8_t *buf, uint32_t index, int committed);
+
+#define RAFT_PROPOSAL_UNKNOWN (-1)
+
+extern process_event_t raft_event_committed;
+
+extern process_event_t raft_event_failed;
+
+extern process_event_t raft_event_unknown;
+
+struct Proposal {
+
+  const uint8_t *buf;      //the proposer's buffer, only handed back
+
+  raft_propose_cb cb;
+
+  struct process *process; //posted to when cb is NULL
+
+  uint32_t index;          //last entry once appended
+
+  uint32_t term;           //term it was appended in
+
+  uint8_t len;
+
+  uint8_t data[RAFT_PROPOSAL_SIZE];
+
+};
+
+//oldest first, the first appended slots from head are in the log
+struct ProposalQueue {
+
+  struct Proposal slots[RAFT_PROPOSAL_QUEUE];
+
+  uint8_t head;
+
+  uint8_t count;
+
+  uint8_t appended;
+
+};
+
+void raft_proposal_init(struct ProposalQueue *queue);
+
+//copies buf, returns 0 when the queue is full or len is 0 or above RAFT_PROPOSAL_SIZE
+int raft_proposal_push(struct ProposalQueue *queue, const uint8_t *buf, uint8_t len, \
+  raft_propose_cb cb, struct process *process);
+
+//leader: append the queued proposals in order while the log has room and
+//store them as one group, returns the number of entries appended. If the
+//group cannot be stored it is taken out of the log again and every
+//proposal not appended before is failed, returning 0
+uint32_t raft_proposal_flush(struct Raft *node);
+
+//report every appended proposal that was applied or whose entries are gone,
+//checked against the snapshot's last entry when they were compacted
+void raft_proposal_settle(struct ProposalQueue *queue, struct RaftLog *log, uint32_t lastApplied);
+
+//fail the proposals not appended yet, we are no longer leader or the flash failed
+void raft_proposal_drop(struct ProposalQueue *queue);
+
+#endif /* RAFT_PROPOSAL_H_ */
@@ -0,0 +1,55 @@
+/******************************
+
+* Raft Quorum
+
+*******************************/
+
+#include "raft_quorum.h"
+
+
+
+void raft_quorum_start(struct Quorum *quorum, uint32_t term) {
+
+  quorum->term = term;
+  quorum->granted = 0;
+
+}
+
+
+
+int raft_quorum_add(struct Quorum *quorum, uint32_t term, unsigned short int id) {
+
+  if (term != quorum->term || id == 0 || id > RAFT_BITMAP_NODES || (quorum->granted & RAFT_BIT(id)))
+    return 0;
+
+  quorum->granted |= RAFT_BIT(id);
+
+  return 1;
+
+}
+
+
+
+uint8_t raft_bitmap_count(raft_bitmap_t bits) {
+
+#ifdef __GNUC__
+  return __builtin_popcountl(bits);
+#else
+  uint8_t n = 0;
+
+  //one round per set bit
+  for (; bits != 0; bits &= bits - 1)
+    ++n;
+
+  return n;
+#endif
+
+}
+
+
+
+int raft_quorum_met(raft_bitmap_t granted, raft_bitmap_t voters) {
+
+  return raft_bitmap_count(granted & voters) > raft_bitmap_count(voters) / 2;
+
+}
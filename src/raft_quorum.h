@@ -0,0 +1,47 @@
+/******************************
+
+* Raft Quorum
+
+* Node sets as one bit per node id (bit id - 1) in a word: recording an
+* answer and spotting a duplicate are single bit operations and a quorum
+* is a population count, with nothing to allocate. A Quorum collects the
+* answers of one term only, so a vote delivered twice or left over from
+* an earlier election is never counted again. Elections and the leader's
+* commit check both decide with raft_quorum_met() against the voters mask.
+
+*******************************/
+
+#ifndef RAFT_QUORUM_H_
+#define RAFT_QUORUM_H_
+
+#include <stdint.h>
+
+typedef uint32_t raft_bitmap_t;
+
+#define RAFT_BITMAP_NODES 32 //highest node id a bitmap holds
+
+#define RAFT_BIT(id) ((raft_bitmap_t)1 << ((id) - 1))
+
+//node ids 1 ... n
+#define RAFT_BITMAP_FIRST(n) ((n) >= RAFT_BITMAP_NODES ? ~(raft_bitmap_t)0 : RAFT_BIT((n) + 1) - 1)
+
+struct Quorum {
+
+  uint32_t term;         //term the answers are for
+
+  raft_bitmap_t granted; //ids that answered yes
+
+};
+
+//forget every answer and collect for term from now on
+void raft_quorum_start(struct Quorum *quorum, uint32_t term);
+
+//records id, 0 for another term, an id out of range or a duplicate
+int raft_quorum_add(struct Quorum *quorum, uint32_t term, unsigned short int id);
+
+uint8_t raft_bitmap_count(raft_bitmap_t bits);
+
+//more than half of voters are in granted, ids outside voters do not count
+int raft_quorum_met(raft_bitmap_t granted, raft_bitmap_t voters);
+
+#endif /* RAFT_QUORUM_H_ */
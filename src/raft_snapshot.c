@@ -0,0 +1,130 @@
+/******************************
+
+* Raft Snapshot
+
+*******************************/
+
+#include "contiki.h"
+
+#include "raft.h"
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+
+//snapshot being received, only replaces node->snapshot once complete
+static struct Snapshot incoming;
+
+static uint16_t received;
+
+
+
+void raft_snapshot_init(struct Snapshot *snapshot) {
+
+  snapshot->lastIndex = 0;
+
+  snapshot->lastTerm = 0;
+
+  snapshot->voters = RAFT_BITMAP_FIRST(TOTAL_NODES);
+
+  snapshot->len = 0;
+
+  received = 0;
+
+}
+
+
+
+void raft_snapshot_take(struct Raft *node) {
+
+  struct Snapshot *snapshot = &node->snapshot;
+
+  if (node->lastApplied <= snapshot->lastIndex)
+    return;
+
+  snapshot->voters = raft_config_at(node, node->lastApplied);
+  snapshot->lastIndex = node->lastApplied;
+  snapshot->lastTerm = raft_log_term(&node->log, node->lastApplied);
+  snapshot->len = node->stateMachine->save(snapshot->data, RAFT_SNAPSHOT_SIZE);
+
+  raft_log_discard(&node->log, snapshot->lastIndex);
+
+  raft_storage_compact(node);
+
+  TRACE_INFO("SNAPSHOT TAKEN: {lastIndex: %lu, lastTerm: %lu, len: %d}\n", \
+    (unsigned long)snapshot->lastIndex, (unsigned long)snapshot->lastTerm, snapshot->len);
+
+  TRACE_EVENT(trace_snapshot, 0, snapshot->lastTerm, snapshot->lastIndex);
+
+}
+
+
+
+static void install(struct Raft *node) {
+
+  memcpy(&node->snapshot, &incoming, sizeof(incoming));
+
+  node->stateMachine->restore(incoming.data, incoming.len);
+
+  //keep any suffix that follows on from the snapshot, otherwise start over after it
+  if (raft_log_term(&node->log, incoming.lastIndex) == incoming.lastTerm && \
+    incoming.lastIndex <= node->log.lastIndex)
+    raft_log_discard(&node->log, incoming.lastIndex);
+  else
+    raft_log_reset(&node->log, incoming.lastIndex, incoming.lastTerm);
+
+  node->lastLogIndex = node->log.lastIndex;
+  node->lastLogTerm = raft_log_term(&node->log, node->lastLogIndex);
+  node->prevLogIndex = node->lastLogIndex;
+  node->prevLogTerm = node->lastLogTerm;
+
+  node->lastApplied = incoming.lastIndex;
+  if (node->commitIndex < incoming.lastIndex)
+    node->commitIndex = incoming.lastIndex;
+  if (node->leaderCommit < incoming.lastIndex)
+    node->leaderCommit = incoming.lastIndex;
+
+  raft_config_update(node);
+
+  raft_storage_compact(node);
+
+  TRACE_INFO("SNAPSHOT INSTALLED: {lastIndex: %lu, lastTerm: %lu, len: %d}\n", \
+    (unsigned long)incoming.lastIndex, (unsigned long)incoming.lastTerm, incoming.len);
+
+  TRACE_EVENT(trace_install, 0, incoming.lastTerm, incoming.lastIndex);
+
+}
+
+
+
+uint16_t raft_snapshot_receive(struct Raft *node, struct InstallSnapshot *chunk) {
+
+  //nothing to do for a snapshot we already cover
+  if (chunk->lastIndex <= node->lastApplied)
+    return chunk->total;
+
+  //a new snapshot (or a restarted one) begins at offset 0
+  if (chunk->offset == 0 || chunk->lastIndex != incoming.lastIndex) {
+    incoming.lastIndex = chunk->lastIndex;
+    incoming.lastTerm = chunk->lastTerm;
+    incoming.voters = chunk->voters;
+    incoming.len = chunk->total;
+    received = 0;
+  }
+
+  //out of order chunk, ask for the one we are missing
+  if (chunk->offset != received || chunk->total > RAFT_SNAPSHOT_SIZE || \
+    received + chunk->count > chunk->total)
+    return received;
+
+  memcpy(incoming.data + received, chunk->data, chunk->count);
+  received += chunk->count;
+
+  if (received == incoming.len)
+    install(node);
+
+  return received;
+
+}
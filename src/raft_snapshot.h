@@ -0,0 +1,50 @@
+/******************************
+
+* Raft Snapshot
+
+* State machine snapshots taken at lastApplied. Taking one lets the log
+* drop everything it covers; followers that fall behind the compacted
+* prefix are brought back with InstallSnapshot, streamed in frame sized
+* chunks that resume from the last offset the follower acknowledged.
+
+*******************************/
+
+#ifndef RAFT_SNAPSHOT_H_
+#define RAFT_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include "raft_quorum.h"
+
+#ifndef RAFT_SNAPSHOT_SIZE
+#define RAFT_SNAPSHOT_SIZE 128 //largest state machine image in bytes
+#endif
+
+struct Raft;
+
+struct InstallSnapshot;
+
+struct Snapshot {
+
+  uint32_t lastIndex; //last log entry covered by the image
+
+  uint32_t lastTerm;
+
+  raft_bitmap_t voters; //configuration as of lastIndex, config entries are compacted with the rest
+
+  uint16_t len;
+
+  uint8_t data[RAFT_SNAPSHOT_SIZE];
+
+};
+
+void raft_snapshot_init(struct Snapshot *snapshot);
+
+//snapshot the state machine at lastApplied and discard the log up to it
+void raft_snapshot_take(struct Raft *node);
+
+//store a received chunk, returns the offset the follower expects next.
+//the snapshot is installed once the last chunk is in.
+uint16_t raft_snapshot_receive(struct Raft *node, struct InstallSnapshot *chunk);
+
+#endif /* RAFT_SNAPSHOT_H_ */
@@ -0,0 +1,1083 @@
+/******************************
+
+* Raft Step
+
+*******************************/
+
+#include "contiki.h"
+
+#include "raft.h"
+
+#include <string.h>
+
+
+
+typedef void (* raft_handler)(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out);
+
+static void start_election(struct Raft *node, struct RaftOutputs *out);
+
+static void leader_heartbeat(struct Raft *node, struct RaftOutputs *out);
+
+static void send_append_entries(struct Raft *node, struct RaftOutputs *out);
+
+static void send_repair(struct Raft *node, struct Peer *peer, struct RaftOutputs *out);
+
+static void request_repair(struct Raft *node, struct Peer *peer, struct RaftOutputs *out);
+
+static void send_snapshot_chunk(struct Raft *node, struct Peer *peer, struct RaftOutputs *out);
+
+
+
+//frames are encoded straight into the sink's room: frame_begin() hands the
+//builders its data area and frame_send() sends what they wrote
+
+static bool frame_room(struct RaftOutputs *out) {
+
+  return out->count < RAFT_STEP_FRAMES;
+
+}
+
+static uint8_t *frame_begin(struct RaftOutputs *out) {
+
+  return out->sink->begin();
+
+}
+
+static void frame_send(struct RaftOutputs *out, unsigned short int to, uint16_t len, \
+  clock_time_t delay) {
+
+  ++out->count;
+
+  out->sink->end(to, len, delay);
+
+}
+
+static void frame_end(struct RaftOutputs *out, unsigned short int to, uint16_t len) {
+
+  frame_send(out, to, len, 0);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//a leader is alive if it is us or its last frame is younger than our base
+//timeout, while it is nobody gets a pre-vote from us
+
+static bool leader_alive(struct Raft *node, clock_time_t now) {
+
+  return node->state == leader || (node->timer.leader != 0 && \
+    now - node->timer.lastHeard < node->timer.base);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//any state
+
+static void recv_pre_election(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Election electIn;
+  struct Election *elect = &electIn;
+  uint16_t len;
+
+  if (!decode_election(event->buf, event->len, elect))
+    return;
+
+  TRACE_DEBUG("PRE-ELECTION BROADCAST MESSAGE RECEIVED \n");
+  election_print(elect);
+
+  //granted on the same log check as a real vote, for a term newer than
+  //ours, and only when we lost our leader too. nothing is stored and our
+  //timer keeps running, a refusal would change nothing at the sender so
+  //only grants are sent
+
+  if (elect->term <= node->term || leader_alive(node, event->now) || \
+    !((elect->lastLogTerm > node->lastLogTerm) || ((elect->lastLogIndex >= node->lastLogIndex) && \
+    (elect->lastLogTerm == node->lastLogTerm)))) {
+    TRACE_DEBUG("PRE-VOTE NOT GRANTED \n");
+    return;
+  }
+
+  TRACE_DEBUG("PRE-VOTE GRANTED! \t");
+  TRACE_DEBUG("voteFor: %d \n", elect->from);
+  TRACE_EVENT(trace_pre_vote, elect->from, elect->term, node->lastLogIndex);
+
+  len = build_vote(frame_begin(out), pre_vote, elect->term, node->id, elect->from, true);
+  frame_end(out, elect->from, len);
+
+}
+
+
+
+//any state
+
+static void recv_pre_vote(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Vote voteIn;
+  struct Vote *vote = &voteIn;
+
+  if (!decode_vote(event->buf, event->len, vote))
+    return;
+
+  TRACE_DEBUG("PRE-VOTE UNICAST MESSAGE RECEIVED \n");
+  vote_print(vote);
+
+  //late grants for a round we gave up on, or one a live leader ended, count for nothing
+  if (!node->preVote || leader_alive(node, event->now) || \
+    !vote->voteGranted || !id_compare(vote->voteFor, node->id))
+    return;
+
+  if (!raft_quorum_add(&node->votes, vote->term, vote->from)) {
+    TRACE_DEBUG("RECEIVED DUPLICATE OR STALE PRE-VOTE \n");
+    return;
+  }
+
+  TRACE_DEBUG("+1 PRE-VOTE \n");
+
+  if (raft_quorum_met(node->votes.granted, node->voters))
+    start_election(node, out);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+#if RAFT_OVERHEAR
+
+//follower: overheard acks hold for one term, a new one starts from nothing
+
+static struct Overheard *overheard(struct Raft *node) {
+
+  if (node->overheard.term != node->term) {
+    memset(&node->overheard, 0, sizeof(node->overheard));
+    node->overheard.term = node->term;
+  }
+
+  return &node->overheard;
+
+}
+
+
+
+//follower: the highest entry of this term that our log shares with the
+//leader and a quorum acked is committed. Every ack of the term means the
+//sender's log matches the leader's up to it, and the leader holds all of
+//them. Older entries are committed along with it, never by counting
+
+static bool overhear_commit(struct Raft *node, unsigned short int from) {
+
+  struct Overheard *o = overheard(node);
+  uint32_t index = o->match;
+  int i = 0;
+
+  if (o->leader == 0)
+    return false;
+
+  for (; index > node->commitIndex; --index) {
+    raft_bitmap_t acked = RAFT_BIT(node->id) | RAFT_BIT(o->leader);
+
+    if (raft_log_term(&node->log, index) != o->term)
+      return false;
+
+    for (i = 0; i < RAFT_MAX_NODES; ++i)
+      if (o->acked[i] >= index)
+        acked |= RAFT_BIT(i + 1);
+
+    if (raft_quorum_met(acked, node->voters)) {
+      //leaderCommit too, it is what we start from should we lead next,
+      //and compaction may drop anything up to commitIndex
+      node->commitIndex = index;
+      node->leaderCommit = index;
+      TRACE_DEBUG("COMMITTED ON OVERHEARD ACKS TO INDEX %lu\n", (unsigned long)index);
+      TRACE_EVENT(trace_commit, from, node->term, index);
+      return true;
+    }
+  }
+
+  return false;
+
+}
+
+
+
+//another follower's ack, broadcast for us as much as for the leader
+
+static void follower_response(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Response responseIn;
+  struct Response *response = &responseIn;
+  struct Overheard *o;
+
+  if (!decode_response(event->buf, event->len, response) || !response->success || \
+    response->term != node->term || response->from == 0 || response->from > RAFT_MAX_NODES)
+    return;
+
+  o = overheard(node);
+
+  if (response->prevLogIndex > o->acked[response->from - 1])
+    o->acked[response->from - 1] = response->prevLogIndex;
+
+  if (overhear_commit(node, response->from))
+    out->apply = true;
+
+}
+
+#endif
+
+#if RAFT_ACK_SLOT_MS
+
+#define ACK_SLOT_TICKS RAFT_MS_TO_TICKS(RAFT_ACK_SLOT_MS)
+
+//turns that start before the next heartbeat, each no later than one tick short of it
+#define ACK_SLOTS ((RAFT_BEAT_TICKS(0) - 1) / ACK_SLOT_TICKS + 1)
+
+//follower: our turn to answer a broadcast from leader, the peer table slot
+//with the leader's taken out, so ids 1 to n give n - 1 turns. Past
+//ACK_SLOTS they wrap and share, an ack due after the next broadcast would
+//only ever be replaced by the next one
+
+static uint8_t ack_slot(unsigned short int id, unsigned short int leader) {
+
+  return (id - 1 - (leader < id ? 1 : 0)) % ACK_SLOTS;
+
+}
+
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+static void follower_election(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Election electIn;
+  struct Election *elect = &electIn;
+  unsigned short int nullAddr = 0;
+  bool granted = false;
+  uint16_t len;
+
+  if (!decode_election(event->buf, event->len, elect))
+    return;
+
+  TRACE_DEBUG("ELECTION BROADCAST MESSAGE RECEIVED BY FOLLLOWER \n");
+
+  election_print(elect);
+
+  out->resetTimeout = true;
+
+  if (elect->term >= node->term) {
+    //a new term brings a new vote
+    if (elect->term > node->term)
+      node->votedFor = 0;
+    node->term = elect->term;
+
+    if ((id_compare(nullAddr, node->votedFor) || id_compare(elect->from, node->votedFor)) && \
+      ((elect->lastLogTerm > node->lastLogTerm) || ((elect->lastLogIndex >= node->lastLogIndex) && \
+      (elect->lastLogTerm == node->lastLogTerm)))) { //vote has not been used
+
+      node->votedFor = elect->from;
+      granted = true;
+
+      TRACE_DEBUG("VOTE GRANTED! \t");
+      TRACE_DEBUG("voteFor: %d \n", elect->from);
+      TRACE_EVENT(trace_vote, elect->from, node->term, node->lastLogIndex);
+    }
+  }
+
+  if (!granted) { //vote was used this term
+    TRACE_DEBUG("VOTE NOT GRANTED \n");
+  }
+
+  //the vote must be on flash before the candidate can count it
+  if (!raft_storage_save_state(node))
+    return;
+
+  len = build_vote(frame_begin(out), vote, node->term, node->id, granted ? elect->from : 0, granted);
+  frame_end(out, elect->from, len);
+
+  TRACE_DEBUG("VOTE UNICAST MESSAGE SENT TO CANDIDATE\n");
+
+}
+
+
+
+//append entries (an empty batch is a plain heartbeat)
+
+static void follower_append(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct AppendEntries appendIn;
+  struct AppendEntries *append = &appendIn;
+  unsigned short int to;
+  uint16_t len;
+
+  if (!decode_append_entries(event->buf, event->len, append))
+    return;
+
+  to = append->from;
+
+  TRACE_DEBUG("APPEND ENTRIES BROADCAST RECEIVED BY FOLLOWER \n");
+  append_entries_print(append);
+
+  //only the current leader holds off elections, and its frames time the link
+
+  if (append->term >= node->term) {
+    if (append->term > node->term)
+      node->votedFor = 0;
+    node->term = append->term;
+    node->currentTerm = append->term;
+
+    raft_timer_heard(&node->timer, append->from, event->now, append->idle);
+    out->resetTimeout = true;
+  }
+
+  //the batch must follow on from our log, anything before our
+  //first retained entry is committed and therefore matches
+  bool logOK = (append->prevLogIndex <= node->lastLogIndex) && \
+    (append->prevLogIndex < node->log.firstIndex - 1 || \
+    raft_log_term(&node->log, append->prevLogIndex) == append->prevLogTerm);
+
+  if ((append->term == node->term) && logOK) {
+    TRACE_DEBUG("APPEND ENTRIES ACCEPTED BY FOLLOWER \n");
+
+    //append the whole batch, skipping entries we already hold and
+    //dropping our suffix from the first conflicting one
+    uint32_t index = append->prevLogIndex;
+    uint32_t firstNew = 0;
+    uint8_t i = 0;
+    for (; i < append->count; ++i) {
+      ++index;
+      if (index < node->log.firstIndex)
+        continue;
+      if (index <= node->log.lastIndex) {
+        if (raft_log_term(&node->log, index) == append->entryTerm)
+          continue;
+        raft_log_truncate(&node->log, index);
+        TRACE_EVENT(trace_truncate, append->from, node->term, index);
+      }
+      if (raft_log_full(&node->log))
+        raft_compact(node);
+      if (!raft_log_append(&node->log, append->entryTerm, append->entryKind, append->entries[i]))
+        break;
+      if (firstNew == 0)
+        firstNew = index;
+    }
+
+    //a change takes effect once it is in the log, or is undone
+    //with the suffix it was truncated with
+    raft_config_update(node);
+
+    //group commit: everything this batch added goes to flash
+    //together, and nothing is acked that did not make it
+    if (!raft_storage_save_state(node) || \
+      (firstNew != 0 && !raft_storage_append(node, firstNew)))
+      return;
+
+    node->lastLogIndex = node->log.lastIndex;
+    node->lastLogTerm = raft_log_term(&node->log, node->lastLogIndex);
+    node->prevLogIndex = node->lastLogIndex;
+    node->prevLogTerm = node->lastLogTerm;
+
+    //only the part of the batch we stored is known to match the leader
+    uint32_t matched = append->prevLogIndex + i;
+
+    //committed stays committed: a batch from before an overheard commit,
+    //or a repair that stops short, must not take it back
+    if (node->leaderCommit < append->leaderCommit && node->leaderCommit < matched)
+      node->leaderCommit = append->leaderCommit < matched ? \
+        append->leaderCommit : matched;
+
+    if (node->commitIndex < node->leaderCommit) {
+      node->commitIndex = node->leaderCommit;
+      out->apply = true;
+    }
+
+#if RAFT_OVERHEAR
+    //the acks of the others may have arrived before this batch
+    if (matched > overheard(node)->match) {
+      node->overheard.leader = append->from;
+      node->overheard.match = matched;
+      if (overhear_commit(node, node->id))
+        out->apply = true;
+    }
+
+    to = 0;
+#endif
+
+#if RAFT_QUIET_ACKS
+    //a heartbeat or a batch we already hold, with everything in it
+    //committed, tells the leader nothing. Stay off the air and leave
+    //it to gaps (NACKs below) and new entries, with a cumulative ack
+    //every RAFT_QUIET_ACKS frames in case the leader missed ours
+    if (firstNew == 0 && matched <= append->leaderCommit && ++node->quiet < RAFT_QUIET_ACKS)
+      return;
+
+    node->quiet = 0;
+#endif
+
+    //one ack for the whole batch
+    len = build_response(frame_begin(out), node->commitIndex, node->currentTerm, node->id, \
+      matched, raft_log_term(&node->log, matched), true);
+
+    TRACE_DEBUG("ACK SENT BY FOLLOWER TO LEADER\n");
+  }
+
+  else {
+    raft_storage_save_state(node);
+
+    //report our own term so a stale leader steps down
+    len = build_response(frame_begin(out), node->commitIndex, node->term, node->id, \
+      node->lastLogIndex, node->lastLogTerm, false);
+
+    TRACE_DEBUG("NACK UNICAST SENT BY FOLLOWER TO LEADER\n");
+  }
+
+#if RAFT_ACK_SLOT_MS
+  //every follower hears a broadcast at the same moment and would answer
+  //it at once, colliding at the leader. Take turns by node id instead,
+  //leaving out the leader's: the slots count from that moment, so they
+  //line up without a common clock. A repair unicast has only us to answer
+  if (event->broadcast) {
+    frame_send(out, to, len, ack_slot(node->id, append->from) * ACK_SLOT_TICKS);
+    return;
+  }
+#endif
+
+  frame_end(out, to, len);
+
+}
+
+
+
+//snapshot chunk from the leader, addressed to one follower
+
+static void follower_snapshot(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct InstallSnapshot chunkIn;
+  struct InstallSnapshot *chunk = &chunkIn;
+  uint16_t offset, len;
+
+  if (!decode_install_snapshot(event->buf, event->len, chunk) || chunk->to != node->id || \
+    chunk->term < node->term)
+    return;
+
+  TRACE_DEBUG("INSTALL SNAPSHOT RECEIVED BY FOLLOWER \n");
+  install_snapshot_print(chunk);
+
+  raft_timer_heard(&node->timer, chunk->from, event->now, 0);
+  out->resetTimeout = true;
+
+  if (chunk->term > node->term)
+    node->votedFor = 0;
+  node->term = chunk->term;
+  node->currentTerm = chunk->term;
+
+  offset = raft_snapshot_receive(node, chunk);
+
+  if (!raft_storage_save_state(node))
+    return;
+
+  len = build_snapshot_response(frame_begin(out), node->term, node->id, chunk->lastIndex, offset);
+  frame_end(out, chunk->from, len);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//vote response
+
+static void candidate_vote(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Vote voteIn;
+  struct Vote *vote = &voteIn;
+
+  out->resetTimeout = true;
+
+  if (!decode_vote(event->buf, event->len, vote))
+    return;
+
+  TRACE_DEBUG("VOTE UNICAST MESSAGE RECEIVED BY CANDIDATE \n");
+  vote_print(vote);
+
+  //vote is for this node
+
+  if (id_compare(vote->voteFor, node->id) && vote->voteGranted) {
+
+    //each voter counts once, and only for the term we are standing in
+    if (raft_quorum_add(&node->votes, vote->term, vote->from)) {
+
+      TRACE_DEBUG("+1 VOTE \n");
+
+      if (raft_quorum_met(node->votes.granted, node->voters)) { //if vote count is majority, change to leader & send heartbeat
+        TRACE_INFO("QUORUM MET, SET NODE AS LEADER \n");
+
+        raft_set_leader(node);
+
+        leader_heartbeat(node, out);
+      }
+
+    }
+
+    else {
+      TRACE_DEBUG("RECEIVED DUPLICATE OR STALE VOTE \n");
+    }
+
+  }
+
+  else if (id_compare(vote->voteFor, node->id) && !vote->voteGranted) {
+    TRACE_DEBUG("VOTE NOT GRANTED UNICAST MESSAGE RECEIVED BY CANDIDATE \n");
+    vote_print(vote);
+    TRACE_INFO("SETTING CANDIDATE AS FOLLOWER \n");
+    raft_set_follower(node);
+  }
+
+}
+
+
+
+static void candidate_append(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  (void)event;
+  (void)out;
+
+  raft_set_follower(node);
+
+}
+
+
+
+static void candidate_election(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Msg msg;
+
+  (void)out;
+
+  if (!decode_msg(event->buf, event->len, &msg) || msg.term <= node->term)
+    return;
+
+  node->term = msg.term;
+  node->currentTerm = msg.term;
+  raft_set_follower(node);
+  raft_storage_save_state(node);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void leader_response(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Response responseIn;
+  struct Response *response = &responseIn;
+
+  if (!decode_response(event->buf, event->len, response))
+    return;
+
+  TRACE_DEBUG("RESPONSE UNICAST MESSAGE RECEIVED BY LEADER\n");
+
+  if (response->term == node->term) {
+
+    struct Peer *peer = raft_peer(node, response->from);
+
+    if (peer == NULL)
+      return;
+
+    //acks carry the last matching index, so a late or duplicate one changes nothing
+    if (response->success) {
+
+      if (response->prevLogIndex > peer->matchIndex) {
+        peer->matchIndex = response->prevLogIndex;
+        if (peer->inflight > 0)
+          --peer->inflight;
+      }
+      if (peer->nextIndex <= peer->matchIndex)
+        peer->nextIndex = peer->matchIndex + 1;
+
+      if (raft_advance_commit(node))
+        out->apply = true;
+
+      //keep the pipeline full, a follower that fell behind the
+      //broadcast is fed its own batches until it catches up
+      if (peer->nextIndex <= node->broadcastIndex && !peer->snapshot)
+        request_repair(node, peer, out);
+      else
+        send_append_entries(node, out);
+    }
+
+    //the follower is missing entries, everything up to its commit index matches our log
+    else {
+      peer->inflight = 0;
+      peer->nextIndex = (response->commitIndex > peer->matchIndex ? \
+        response->commitIndex : peer->matchIndex) + 1;
+      request_repair(node, peer, out);
+    }
+  }
+
+  else if (response->term > node->term) {
+    TRACE_EVENT(trace_step_down, response->from, response->term, node->lastLogIndex);
+    node->term = response->term;
+    node->currentTerm = response->term;
+    raft_set_follower(node);
+    raft_storage_save_state(node);
+  }
+
+}
+
+
+
+//follower acknowledged a snapshot chunk, stream the next one right away
+
+static void leader_snapshot_ack(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct SnapshotResponse responseIn;
+  struct SnapshotResponse *response = &responseIn;
+
+  if (!decode_snapshot_response(event->buf, event->len, response))
+    return;
+
+  snapshot_response_print(response);
+
+  struct Peer *peer = raft_peer(node, response->from);
+
+  if (peer == NULL || !peer->snapshot || response->term != node->term)
+    return;
+
+  //a chunk of an older snapshot, start over with the current one
+  if (response->lastIndex != node->snapshot.lastIndex)
+    peer->snapshotOffset = 0;
+  else
+    peer->snapshotOffset = response->offset;
+
+  if (peer->snapshotOffset < node->snapshot.len || response->lastIndex != node->snapshot.lastIndex)
+    send_snapshot_chunk(node, peer, out);
+
+  //installed, carry on with the entries after it
+  else {
+    peer->snapshot = false;
+    peer->inflight = 0;
+    if (peer->matchIndex < node->snapshot.lastIndex)
+      peer->matchIndex = node->snapshot.lastIndex;
+    peer->nextIndex = peer->matchIndex + 1;
+    if (peer->nextIndex <= node->broadcastIndex)
+      send_repair(node, peer, out);
+  }
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//who handles which frame in which state, anything missing is ignored.
+//pre-votes change no state, every role answers them the same way
+
+static const raft_handler handlers[3][msg_types_count] = {
+  [follower] = {
+    [election] = follower_election,
+    [append] = follower_append,
+    [install_snapshot] = follower_snapshot,
+#if RAFT_OVERHEAR
+    [respond] = follower_response,
+#endif
+    [pre_election] = recv_pre_election,
+    [pre_vote] = recv_pre_vote,
+  },
+  [candidate] = {
+    [vote] = candidate_vote,
+    [append] = candidate_append,
+    [election] = candidate_election,
+    [pre_election] = recv_pre_election,
+    [pre_vote] = recv_pre_vote,
+  },
+  [leader] = {
+    [respond] = leader_response,
+    [snapshot_ack] = leader_snapshot_ack,
+    [pre_election] = recv_pre_election,
+    [pre_vote] = recv_pre_vote,
+  },
+};
+
+/*---------------------------------------------------------------------------*/
+
+//leader: one AppendEntries broadcast of count entries after broadcastIndex
+//(an empty batch is a heartbeat). Followers in sync advance with it
+
+static void broadcast_batch(struct Raft *node, uint8_t count, struct RaftOutputs *out) {
+
+  uint32_t first = node->broadcastIndex + 1;
+  uint16_t len;
+  int i = 0;
+
+  if (!frame_room(out))
+    return;
+
+  //count comes back as the number of entries that fit the frame
+  len = build_append_entries(frame_begin(out), node->term, node->id, node->broadcastIndex, \
+    raft_log_term(&node->log, node->broadcastIndex), node->leaderCommit, node->idle, &node->log, &count);
+
+  node->broadcastIndex += count;
+
+  for (i = 0; i < RAFT_MAX_NODES && count > 0; ++i) {
+    struct Peer *peer = &node->peers[i];
+
+    if (peer->id == node->id || peer->snapshot || peer->nextIndex < first || \
+      peer->inflight >= RAFT_MAX_INFLIGHT)
+      continue;
+
+    if (peer->nextIndex <= node->broadcastIndex)
+      peer->nextIndex = node->broadcastIndex + 1;
+    ++peer->inflight;
+  }
+
+  frame_end(out, 0, len);
+
+}
+
+
+
+//enough voters can take another batch to make a majority with us
+
+static bool window_open(struct Raft *node) {
+
+  raft_bitmap_t ready = RAFT_BIT(node->id);
+  int i = 0;
+
+  for (i = 0; i < RAFT_MAX_NODES; ++i)
+    if (node->peers[i].inflight < RAFT_MAX_INFLIGHT)
+      ready |= RAFT_BIT(node->peers[i].id);
+
+  return raft_quorum_met(ready, node->voters);
+
+}
+
+
+
+//leader: broadcast every entry not sent yet without waiting for the acks
+//of the earlier batches, as long as the window and the step allow
+
+static void send_append_entries(struct Raft *node, struct RaftOutputs *out) {
+
+  while (node->broadcastIndex < node->lastLogIndex && window_open(node) && frame_room(out)) {
+    uint32_t pending = node->lastLogIndex - node->broadcastIndex;
+    broadcast_batch(node, pending > 0xff ? 0xff : pending, out);
+  }
+
+}
+
+
+
+#if RAFT_SHARED_REPAIR
+
+//leader: followers that NACKed since the last beat only ever miss a suffix
+//of the log, since they reject everything after a gap. One broadcast from
+//the earliest gap on covers all of them, each skips what it holds and
+//appends the rest, so repair takes one frame instead of one per follower.
+//Those we compacted past since they were flagged get the snapshot instead.
+//It replaces the heartbeat, true if it was sent
+
+static bool shared_repair(struct Raft *node, struct RaftOutputs *out) {
+
+  uint32_t first = 0, last;
+  uint8_t count = 0;
+  uint16_t len;
+  int i = 0;
+
+  for (i = 0; i < RAFT_MAX_NODES; ++i) {
+    struct Peer *peer = &node->peers[i];
+
+    if (!peer->repair)
+      continue;
+
+    peer->repair = false;
+    if (peer->snapshot)
+      continue;
+
+    if (peer->nextIndex < node->log.firstIndex)
+      send_repair(node, peer, out);
+    else if (first == 0 || peer->nextIndex < first)
+      first = peer->nextIndex;
+  }
+
+  if (first == 0 || !frame_room(out))
+    return false;
+
+  if (node->lastLogIndex >= first) {
+    uint32_t pending = node->lastLogIndex - first + 1;
+    count = pending > 0xff ? 0xff : pending;
+  }
+
+  len = build_append_entries(frame_begin(out), node->term, node->id, first - 1, \
+    raft_log_term(&node->log, first - 1), node->leaderCommit, node->idle, &node->log, &count);
+
+  last = first - 1 + count;
+
+  if (node->broadcastIndex < last)
+    node->broadcastIndex = last;
+
+  for (i = 0; i < RAFT_MAX_NODES; ++i) {
+    struct Peer *peer = &node->peers[i];
+
+    if (peer->id != node->id && !peer->snapshot && peer->nextIndex >= first && peer->nextIndex <= last) {
+      peer->nextIndex = last + 1;
+      ++peer->inflight;
+    }
+  }
+
+  frame_end(out, 0, len);
+
+  TRACE_DEBUG("SHARED REPAIR BROADCAST FROM %lu\n", (unsigned long)first);
+  TRACE_EVENT(trace_repair, 0, node->term, first);
+
+  return true;
+
+}
+
+#endif
+
+
+
+//leader: every interval, a batch still unacknowledged is taken as lost and
+//followers that missed it NACK the next frame. Heartbeat if nothing is new
+
+static void leader_heartbeat(struct Raft *node, struct RaftOutputs *out) {
+
+  uint32_t sent = node->broadcastIndex;
+  bool repaired = false;
+  int i = 0;
+
+  for (i = 0; i < RAFT_MAX_NODES; ++i)
+    node->peers[i].inflight = 0;
+
+#if RAFT_SHARED_REPAIR
+  repaired = shared_repair(node, out);
+#endif
+
+  send_append_entries(node, out);
+
+  if (node->broadcastIndex == sent && !repaired)
+    broadcast_batch(node, 0, out);
+
+}
+
+
+
+//leader: with nothing queued, uncommitted or behind on any voter the next
+//heartbeat waits twice as long as the last, up to RAFT_IDLE_SHIFT, and
+//anything happening goes back to RAFT_HEARTBEAT_MS. Frames announce it
+
+static void leader_pace(struct Raft *node) {
+
+  bool idle = node->proposals.count == 0 && node->commitIndex == node->lastLogIndex;
+  int i = 0;
+
+  for (i = 0; i < RAFT_MAX_NODES && idle; ++i) {
+    struct Peer *peer = &node->peers[i];
+
+    if (peer->id != node->id && (node->voters & RAFT_BIT(peer->id)) && \
+      (peer->matchIndex != node->lastLogIndex || peer->snapshot))
+      idle = false;
+  }
+
+  if (!idle)
+    node->idle = 0;
+  else if (node->idle < RAFT_IDLE_SHIFT)
+    ++node->idle;
+
+}
+
+
+
+//leader: catch up one follower from its nextIndex, or stream the snapshot
+//if we compacted past it
+
+static void send_repair(struct Raft *node, struct Peer *peer, struct RaftOutputs *out) {
+
+  uint32_t first = peer->nextIndex;
+  uint8_t count = 0;
+  uint16_t len;
+
+  if (first < node->log.firstIndex) {
+
+    if (!peer->snapshot) {
+      peer->snapshot = true;
+      peer->snapshotOffset = 0;
+    }
+
+    send_snapshot_chunk(node, peer, out);
+    return;
+
+  }
+
+  if (peer->inflight >= RAFT_MAX_INFLIGHT || !frame_room(out))
+    return;
+
+  if (node->lastLogIndex >= first) {
+    uint32_t pending = node->lastLogIndex - first + 1;
+    count = pending > 0xff ? 0xff : pending;
+  }
+
+  len = build_append_entries(frame_begin(out), node->term, node->id, first - 1, \
+    raft_log_term(&node->log, first - 1), node->leaderCommit, node->idle, &node->log, &count);
+
+  peer->nextIndex = first + count;
+  ++peer->inflight;
+
+  frame_end(out, peer->id, len);
+
+  TRACE_DEBUG("REPAIR APPEND ENTRIES SENT TO %d\n", peer->id);
+  TRACE_EVENT(trace_repair, peer->id, node->term, first);
+
+}
+
+
+
+//leader: a follower needs entries from its nextIndex on. In shared mode it
+//waits for the next heartbeat's broadcast, unless only a snapshot will do
+
+static void request_repair(struct Raft *node, struct Peer *peer, struct RaftOutputs *out) {
+
+#if RAFT_SHARED_REPAIR
+  if (!peer->snapshot && peer->nextIndex >= node->log.firstIndex) {
+    peer->repair = true;
+    return;
+  }
+#endif
+
+  send_repair(node, peer, out);
+
+}
+
+
+
+static void send_snapshot_chunk(struct Raft *node, struct Peer *peer, struct RaftOutputs *out) {
+
+  uint16_t len;
+
+  if (!frame_room(out))
+    return;
+
+  len = build_install_snapshot(frame_begin(out), node->term, node->id, peer->id, \
+    &node->snapshot, peer->snapshotOffset);
+
+  frame_end(out, peer->id, len);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//the real election, only once a quorum said it would vote for us
+
+static void start_election(struct Raft *node, struct RaftOutputs *out) {
+
+  uint16_t len;
+
+  TRACE_INFO("PRE-VOTE QUORUM MET, STARTING ELECTION\n");
+
+  node->term+=1;
+
+  TRACE_DEBUG("+1 NODE TERM\n");
+  raft_set_candidate(node);
+
+  //new term and our own vote are on flash before anyone hears of them
+
+  raft_storage_save_state(node);
+
+  len = build_election(frame_begin(out), election, node->term, node->id, node->lastLogIndex, node->lastLogTerm);
+  frame_end(out, 0, len);
+
+  TRACE_DEBUG("CANDIDATE SENDING ELECTION BROADCAST REQUEST TO ALL\n");
+
+  out->resetTimeout = true;
+
+}
+
+
+
+static void election_timeout(struct Raft *node, struct RaftOutputs *out) {
+
+  TRACE_DEBUG("\nTIMEOUT CALLBACK\n");
+
+  //a node outside the configuration only learns the log
+  if (((node->state == follower) || (node->state == candidate)) && !(node->voters & RAFT_BIT(node->id)))
+    TRACE_DEBUG("MSG TIMEOUT, NOT A VOTER\n");
+
+  else if ((node->state == follower) || (node->state == candidate)) {
+
+    TRACE_INFO("MSG TIMEOUT, ASKING FOR PRE-VOTES\n");
+
+    //a fresh round for the next term, a node that cannot reach a quorum
+    //keeps asking at its own term and never disrupts the others with a
+    //higher one once it is back
+
+    raft_quorum_start(&node->votes, node->term + 1);
+    raft_quorum_add(&node->votes, node->term + 1, node->id);
+    node->preVote = true;
+
+    TRACE_EVENT(trace_pre_vote, 0, node->term + 1, node->lastLogIndex);
+
+    uint16_t len = build_election(frame_begin(out), pre_election, node->term + 1, node->id, \
+      node->lastLogIndex, node->lastLogTerm);
+    frame_end(out, 0, len);
+
+    TRACE_DEBUG("IN TIMEOUT CALLBACK, SENDING PRE-ELECTION BROADCAST REQUEST TO ALL\n");
+
+  }
+
+  out->resetTimeout = true;
+
+}
+
+
+
+static void heartbeat_tick(struct Raft *node, struct RaftOutputs *out) {
+
+  //a leader that removed itself leads until the removal is committed
+  if (node->state == leader && !(node->voters & RAFT_BIT(node->id)) && node->configIndex <= node->commitIndex) {
+    TRACE_INFO("REMOVED FROM THE CONFIGURATION, STEPPING DOWN\n");
+    raft_set_follower(node);
+  }
+
+  if (node->state != leader)
+    return;
+
+  //everything proposed since the last beat goes out in this batch
+
+  raft_proposal_flush(node);
+
+  leader_pace(node);
+
+  TRACE_DEBUG("LEADER SENDING BROADCAST APPEND ENTRIES (WHILE LOOP)\n");
+
+  leader_heartbeat(node, out);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+void raft_step(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out) {
+
+  struct Msg msg;
+  raft_handler handler;
+
+  out->count = 0;
+  out->resetTimeout = false;
+  out->apply = false;
+
+  if (event->type == raft_step_timeout) {
+    election_timeout(node, out);
+    return;
+  }
+
+  if (event->type == raft_step_heartbeat) {
+    heartbeat_tick(node, out);
+    return;
+  }
+
+  //anything that is not a well formed frame is dropped here or by the decoders
+  if (!decode_msg(event->buf, event->len, &msg) || msg.type >= msg_types_count) {
+    TRACE_ERROR("MALFORMED FRAME DROPPED: {from: %d, len: %d}\n", event->from, event->len);
+    TRACE_EVENT(trace_drop, event->from, node->term, event->len);
+    return;
+  }
+
+  broadcast_print(&msg, node);
+
+  handler = handlers[node->state][msg.type];
+
+  if (handler != NULL)
+    handler(node, event, out);
+
+}
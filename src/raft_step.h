@@ -0,0 +1,90 @@
+/******************************
+
+* Raft Step
+
+* The protocol as one call. raft_step() feeds the node one event, a frame
+* received, the election timeout or the leader's heartbeat tick, and
+* returns what has to happen next in a struct RaftOutputs: whether to
+* restart the election timer or wake the apply process. The frames it
+* sends go out through the caller's struct RaftSink as they are built.
+* Received frames are dispatched through a table indexed by state and
+* message type. The step never calls the radio or sets a timer itself, so
+* raft_node.c adapts it to Rime and Contiki timers and a host harness or
+* another network stack can drive it with a sink of its own. It is not
+* free of side effects though, a step also:
+*   - writes the node's flash copy (raft_storage.h) before any frame that
+*     depends on it
+*   - calls the state machine's save() when a full log is compacted, and
+*     restore() when a snapshot is installed; entries are applied only by
+*     raft_apply()
+*   - reports proposals (raft_proposal.h) through their callbacks or a
+*     process_post() to the proposer, the failed ones when the node steps
+*     down or its flash fails and the applied ones at the leader's flush
+*   - switches the LEDs on a change of role
+
+*******************************/
+
+#ifndef RAFT_STEP_H_
+#define RAFT_STEP_H_
+
+#include "contiki.h"
+
+#include <stdint.h>
+
+//included from raft.h, after RAFT_MAX_PAYLOAD and RAFT_MAX_INFLIGHT
+
+#ifndef RAFT_STEP_FRAMES
+#define RAFT_STEP_FRAMES RAFT_MAX_INFLIGHT //frames one step can send, a full window of batches
+#endif
+
+struct Raft;
+
+enum raft_step_events {raft_step_frame, raft_step_timeout, raft_step_heartbeat};
+
+struct RaftEvent {
+
+  uint8_t type;            //enum raft_step_events
+
+  clock_time_t now;
+
+  const uint8_t *buf;      //raft_step_frame: the frame and its length
+  uint16_t len;
+
+  unsigned short int from; //raft_step_frame: link layer sender, only for tracing
+
+  uint8_t broadcast;       //raft_step_frame: heard on the broadcast connection
+
+};
+
+//where the frames of a step go. begin() hands out room for one frame of up
+//to RAFT_MAX_PAYLOAD bytes and end() sends what was written there to node
+//id to, 0 for a broadcast, at once or after delay ticks (RAFT_ACK_SLOT_MS).
+//raft_node.c hands out packetbuf itself, so a frame is encoded once and
+//no step keeps a copy. A received frame may live in that same room, the
+//handlers are done reading it before they begin a frame
+
+struct RaftSink {
+
+  uint8_t *(* begin)(void);
+
+  void (* end)(unsigned short int to, uint16_t len, clock_time_t delay);
+
+};
+
+struct RaftOutputs {
+
+  const struct RaftSink *sink; //set by the caller, kept by raft_step()
+
+  uint8_t count;           //frames sent, at most RAFT_STEP_FRAMES
+
+  uint8_t resetTimeout;    //restart the election timer with a fresh draw
+
+  uint8_t apply;           //the commit index moved, run raft_apply()
+
+};
+
+//the frames are sent during the step, the rest of out is overwritten and
+//is carried out before the next step
+void raft_step(struct Raft *node, const struct RaftEvent *event, struct RaftOutputs *out);
+
+#endif /* RAFT_STEP_H_ */
@@ -0,0 +1,374 @@
+/******************************
+
+* Raft Storage
+
+*******************************/
+
+#include "contiki.h"
+
+#include "cfs/cfs.h"
+
+#ifdef CONTIKI_TARGET_SKY
+#include "cfs/cfs-coffee.h"
+#endif
+
+#include "raft.h"
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define STATE_FILE "raft.state"   //term, votedFor
+
+#define STATE_LEN 6
+
+#define SNAPSHOT_HEADER 16 //lastIndex, lastTerm, voters, len, check, followed by len bytes of data
+
+#define RECORD_HEADER 10 //index, term, kind, count, followed by count values of that term and kind
+
+static const char * const logFiles[] = {"raft.log0", "raft.log1"};
+
+//the snapshot the log file of the same slot continues from
+static const char * const snapshotFiles[] = {"raft.snap0", "raft.snap1"};
+
+//slot of the log file currently appended to and its snapshot, flips on every compaction
+static uint8_t logSlot;
+
+//term and vote as last written, to skip redundant flash writes
+static uint32_t savedTerm;
+
+static unsigned short int savedVote;
+
+//gathers records so a batch reaches flash in one write
+static uint8_t buf[RAFT_STORAGE_BUF];
+
+
+
+static void put32(uint8_t *p, uint32_t v) {
+
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+
+}
+
+static uint32_t get32(const uint8_t *p) {
+
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+
+}
+
+
+
+//Fletcher-16, tells a snapshot a reset cut short from a complete one
+
+static uint16_t fletcher(uint16_t sum, const uint8_t *p, uint16_t len) {
+
+  uint16_t a = sum & 0xff, b = sum >> 8;
+
+  while (len-- > 0) {
+    a = (a + *p++) % 255;
+    b = (b + a) % 255;
+  }
+
+  return a | (b << 8);
+
+}
+
+
+
+static void reserve_log(uint8_t slot) {
+
+#ifdef CONTIKI_TARGET_SKY
+  cfs_coffee_reserve(logFiles[slot], RAFT_STORAGE_LOG_SIZE);
+#endif
+
+}
+
+
+
+//write entries first..lastIndex as runs of one term and kind, flushing only when buf is full
+
+static int write_entries(int fd, struct RaftLog *log, uint32_t first) {
+
+  uint16_t len = 0;
+  uint32_t index = first < log->firstIndex ? log->firstIndex : first;
+
+  while (index <= log->lastIndex) {
+
+    uint32_t term = raft_log_term(log, index);
+    uint8_t kind = raft_log_get(log, index)->kind;
+    uint16_t header;
+    uint8_t count = 0;
+
+    if (len + RECORD_HEADER + 1 > RAFT_STORAGE_BUF) {
+      if (cfs_write(fd, buf, len) != len)
+        return 0;
+      len = 0;
+    }
+
+    header = len;
+    put32(buf + header, index);
+    put32(buf + header + 4, term);
+    buf[header + 8] = kind;
+    len += RECORD_HEADER;
+
+    while (index <= log->lastIndex && raft_log_term(log, index) == term && \
+      raft_log_get(log, index)->kind == kind && len < RAFT_STORAGE_BUF && count < 255) {
+      buf[len++] = raft_log_get(log, index)->value;
+      ++count;
+      ++index;
+    }
+
+    buf[header + 9] = count;
+
+  }
+
+  return len == 0 || cfs_write(fd, buf, len) == len;
+
+}
+
+
+
+int raft_storage_save_state(struct Raft *node) {
+
+  int fd, ok;
+
+  if (node->term == savedTerm && node->votedFor == savedVote)
+    return 1;
+
+  put32(buf, node->term);
+  buf[4] = node->votedFor & 0xff;
+  buf[5] = (node->votedFor >> 8) & 0xff;
+
+  fd = cfs_open(STATE_FILE, CFS_WRITE);
+  ok = fd >= 0 && cfs_write(fd, buf, STATE_LEN) == STATE_LEN;
+  if (fd >= 0)
+    cfs_close(fd);
+
+  if (!ok) {
+    TRACE_ERROR("STORAGE: STATE WRITE FAILED\n");
+    TRACE_EVENT(trace_storage_error, 0, node->term, 0);
+    return 0;
+  }
+
+  savedTerm = node->term;
+  savedVote = node->votedFor;
+
+  return 1;
+
+}
+
+
+
+int raft_storage_append(struct Raft *node, uint32_t first) {
+
+  int fd, ok;
+
+  if (first > node->log.lastIndex)
+    return 1;
+
+  fd = cfs_open(logFiles[logSlot], CFS_WRITE | CFS_APPEND);
+  ok = fd >= 0 && write_entries(fd, &node->log, first);
+  if (fd >= 0)
+    cfs_close(fd);
+
+  if (!ok) {
+    TRACE_ERROR("STORAGE: LOG WRITE FAILED AT INDEX %lu\n", (unsigned long)first);
+    TRACE_EVENT(trace_storage_error, 0, node->term, first);
+  }
+
+  return ok;
+
+}
+
+
+
+int raft_storage_compact(struct Raft *node) {
+
+  struct Snapshot *snapshot = &node->snapshot;
+  uint8_t next = logSlot ^ 1;
+  int fd, ok;
+
+  //the retained entries and then the snapshot go to the other slot, the
+  //old pair is only removed once both are complete. A reset in between
+  //leaves the old pair or, past a checked snapshot, the new one to recover
+  cfs_remove(logFiles[next]);
+  reserve_log(next);
+
+  fd = cfs_open(logFiles[next], CFS_WRITE);
+  ok = fd >= 0 && write_entries(fd, &node->log, node->log.firstIndex);
+  if (fd >= 0)
+    cfs_close(fd);
+
+  if (ok) {
+    uint16_t check;
+
+    put32(buf, snapshot->lastIndex);
+    put32(buf + 4, snapshot->lastTerm);
+    put32(buf + 8, snapshot->voters);
+    buf[12] = snapshot->len & 0xff;
+    buf[13] = (snapshot->len >> 8) & 0xff;
+    check = fletcher(fletcher(0, buf, 14), snapshot->data, snapshot->len);
+    buf[14] = check & 0xff;
+    buf[15] = (check >> 8) & 0xff;
+
+    fd = cfs_open(snapshotFiles[next], CFS_WRITE);
+    ok = fd >= 0 && cfs_write(fd, buf, SNAPSHOT_HEADER) == SNAPSHOT_HEADER && \
+      cfs_write(fd, snapshot->data, snapshot->len) == snapshot->len;
+    if (fd >= 0)
+      cfs_close(fd);
+  }
+
+  if (!ok) {
+    TRACE_ERROR("STORAGE: SNAPSHOT WRITE FAILED\n");
+    TRACE_EVENT(trace_storage_error, 0, snapshot->lastTerm, snapshot->lastIndex);
+    return 0;
+  }
+
+  cfs_remove(logFiles[logSlot]);
+  cfs_remove(snapshotFiles[logSlot]);
+  logSlot = next;
+
+  return 1;
+
+}
+
+
+
+//rebuild the log from the records, a record starting inside the log
+//replaces everything from its first index on (a truncation happened)
+
+static void replay_log(struct Raft *node, int fd) {
+
+  struct RaftLog *log = &node->log;
+  uint8_t header[RECORD_HEADER];
+
+  while (cfs_read(fd, header, RECORD_HEADER) == RECORD_HEADER) {
+
+    uint32_t index = get32(header);
+    uint32_t term = get32(header + 4);
+    uint8_t kind = header[8];
+    uint8_t count = header[9];
+    uint8_t i;
+
+    if (count > RAFT_STORAGE_BUF - RECORD_HEADER || cfs_read(fd, buf, count) != count)
+      return;
+
+    for (i = 0; i < count; ++i, ++index) {
+      if (index < log->firstIndex)
+        continue;
+      if (index > log->lastIndex + 1)
+        return;
+      if (index <= log->lastIndex)
+        raft_log_truncate(log, index);
+      if (!raft_log_append(log, term, kind, buf[i]))
+        return;
+    }
+
+  }
+
+}
+
+
+
+//load the snapshot of slot into snapshot, 0 when there is none or a reset
+//cut it short, snapshot->data is overwritten either way
+
+static int read_snapshot(struct Snapshot *snapshot, uint8_t slot) {
+
+  int fd = cfs_open(snapshotFiles[slot], CFS_READ);
+  int ok = 0;
+
+  if (fd < 0)
+    return 0;
+
+  if (cfs_read(fd, buf, SNAPSHOT_HEADER) == SNAPSHOT_HEADER) {
+    uint16_t len = buf[12] | (buf[13] << 8);
+    uint16_t check = buf[14] | (buf[15] << 8);
+
+    ok = len <= RAFT_SNAPSHOT_SIZE && cfs_read(fd, snapshot->data, len) == len && \
+      fletcher(fletcher(0, buf, 14), snapshot->data, len) == check;
+
+    if (ok) {
+      snapshot->lastIndex = get32(buf);
+      snapshot->lastTerm = get32(buf + 4);
+      snapshot->voters = get32(buf + 8);
+      snapshot->len = len;
+    }
+  }
+
+  cfs_close(fd);
+
+  return ok;
+
+}
+
+
+
+void raft_storage_recover(struct Raft *node) {
+
+  struct Snapshot *snapshot = &node->snapshot;
+  uint32_t first = 0;
+  int fd, found;
+
+  logSlot = 0;
+
+  fd = cfs_open(STATE_FILE, CFS_READ);
+  if (fd >= 0) {
+    if (cfs_read(fd, buf, STATE_LEN) == STATE_LEN) {
+      node->term = get32(buf);
+      node->currentTerm = node->term;
+      node->votedFor = buf[4] | (buf[5] << 8);
+    }
+    cfs_close(fd);
+  }
+
+  savedTerm = node->term;
+  savedVote = node->votedFor;
+
+  //both slots are complete after a reset between writing the new pair and
+  //removing the old one, the newer snapshot wins
+  found = read_snapshot(snapshot, 0);
+  if (found)
+    first = snapshot->lastIndex;
+
+  if (read_snapshot(snapshot, 1) && (!found || snapshot->lastIndex > first)) {
+    logSlot = 1;
+    found = 1;
+  }
+  else if (found)
+    read_snapshot(snapshot, 0);
+
+  if (found) {
+    node->stateMachine->restore(snapshot->data, snapshot->len);
+    raft_log_reset(&node->log, snapshot->lastIndex, snapshot->lastTerm);
+
+    node->lastApplied = snapshot->lastIndex;
+    node->commitIndex = snapshot->lastIndex;
+    node->leaderCommit = snapshot->lastIndex;
+  }
+
+  fd = cfs_open(logFiles[logSlot], CFS_READ);
+  if (fd >= 0) {
+    replay_log(node, fd);
+    cfs_close(fd);
+  }
+  else
+    reserve_log(logSlot);
+
+  node->lastLogIndex = node->log.lastIndex;
+  node->lastLogTerm = raft_log_term(&node->log, node->lastLogIndex);
+  node->prevLogIndex = node->lastLogIndex;
+  node->prevLogTerm = node->lastLogTerm;
+
+  TRACE_INFO("STORAGE RECOVERED: {term: %lu, votedFor: %d, snapshot: %lu, lastLogIndex: %lu}\n", \
+    (unsigned long)node->term, node->votedFor, (unsigned long)snapshot->lastIndex, \
+    (unsigned long)node->lastLogIndex);
+
+  TRACE_EVENT(trace_boot, 0, node->term, node->lastLogIndex);
+
+}
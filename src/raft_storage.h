@@ -0,0 +1,44 @@
+/******************************
+
+* Raft Storage
+
+* Stable storage on the Contiki File System (Coffee on flash, the POSIX
+* backed CFS on native builds). The current term and vote are rewritten
+* in place, log entries are appended as records of one term run each and
+* every batch is written with as few flash writes as possible before it
+* is acknowledged. Compaction writes the snapshot and a fresh log file to
+* the other of two slots, so the files never outgrow the ring and the old
+* pair stays valid until the new one is complete.
+
+*******************************/
+
+#ifndef RAFT_STORAGE_H_
+#define RAFT_STORAGE_H_
+
+#include <stdint.h>
+
+#ifndef RAFT_STORAGE_BUF
+#define RAFT_STORAGE_BUF 128 //bytes gathered per flash write, one full AppendEntries batch of one term
+#endif
+
+#ifndef RAFT_STORAGE_LOG_SIZE
+#define RAFT_STORAGE_LOG_SIZE 1024 //bytes reserved for each log file on Coffee
+#endif
+
+struct Raft;
+
+//load term, vote, snapshot and log after a reboot, called from raft_init
+void raft_storage_recover(struct Raft *node);
+
+//persist term and votedFor, only touches flash when either changed
+int raft_storage_save_state(struct Raft *node);
+
+//persist the entries from first to the end of the log as one group commit,
+//returns 0 when they did not reach flash and must not be acknowledged
+int raft_storage_append(struct Raft *node, uint32_t first);
+
+//persist node->snapshot and restart the log file from the retained entries,
+//both in the other slot
+int raft_storage_compact(struct Raft *node);
+
+#endif /* RAFT_STORAGE_H_ */
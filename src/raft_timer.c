@@ -0,0 +1,138 @@
+/******************************
+
+* Raft Election Timer
+
+*******************************/
+
+#include "contiki.h"
+
+#include "lib/random.h"
+
+#include "raft_timer.h"
+
+
+
+#define HEARTBEAT_TICKS RAFT_MS_TO_TICKS(RAFT_HEARTBEAT_MS)
+
+#define MIN_TICKS RAFT_MS_TO_TICKS(RAFT_ELECTION_MIN_MS)
+
+#define MAX_TICKS RAFT_MS_TO_TICKS(RAFT_ELECTION_MAX_MS)
+
+#define SURVIVAL_ONE ((uint32_t)1 << 20) //1.0 in the fixed point of heartbeats_needed
+
+
+
+void raft_timer_init(struct ElectionTimer *timer) {
+
+  timer->base = MIN_TICKS;
+  timer->timeout = timer->base;
+  timer->lastHeard = 0;
+  timer->interval = HEARTBEAT_TICKS;
+  timer->leader = 0;
+  timer->gapAvg = 0;
+  timer->gapDev = 0;
+  timer->loss = RAFT_TIMER_LOSS_PRIOR;
+
+}
+
+
+
+//heartbeats that must all go missing before we time out for the
+//chance of that to drop below 2^-20 at the measured loss rate
+
+static uint32_t heartbeats_needed(uint8_t loss, clock_time_t interval) {
+
+  uint32_t chance = SURVIVAL_ONE;
+  uint32_t n = 0;
+
+  while (chance > 1 && n * interval < MAX_TICKS) {
+    chance = (chance * loss) >> 8;
+    ++n;
+  }
+
+  return n;
+
+}
+
+
+
+//never less than three of the leader's heartbeats
+
+static void raise_floor(struct ElectionTimer *timer) {
+
+  if (timer->base < 3 * timer->interval)
+    timer->base = 3 * timer->interval < MAX_TICKS ? 3 * timer->interval : MAX_TICKS;
+
+}
+
+
+
+void raft_timer_heard(struct ElectionTimer *timer, unsigned short int leader, clock_time_t now, uint8_t idle) {
+
+  clock_time_t gap = now - timer->lastHeard; //wraps correctly with clock_time_t
+  clock_time_t interval = timer->interval;   //what the previous frame announced
+  clock_time_t slots;
+  int32_t delta;
+  uint32_t base, lossBase;
+
+  timer->lastHeard = now;
+  timer->interval = RAFT_BEAT_TICKS(idle < RAFT_IDLE_SHIFT ? idle : RAFT_IDLE_SHIFT);
+
+  //a new leader, its first frame only starts the clock
+  if (leader != timer->leader) {
+    timer->leader = leader;
+    raise_floor(timer);
+    return;
+  }
+
+  //anything longer says only that the link was down
+  if (gap > MAX_TICKS)
+    gap = MAX_TICKS;
+
+  //jitter: avg += (gap - avg) / 8, dev += (|gap - avg| - dev) / 4, both kept scaled
+  if (timer->gapAvg == 0 && timer->gapDev == 0) {
+    timer->gapAvg = (uint32_t)gap << 3;
+    timer->gapDev = (uint32_t)gap << 1;
+  }
+  else {
+    delta = (int32_t)gap - (int32_t)(timer->gapAvg >> 3);
+    timer->gapAvg += delta;
+    if (delta < 0)
+      delta = -delta;
+    timer->gapDev += delta - (int32_t)(timer->gapDev >> 2);
+  }
+
+  //loss: a gap of n heartbeat intervals means n - 1 heartbeats went missing,
+  //each interval moves the rate 1/16 of the way towards lost or received
+  slots = (gap + interval / 2) / interval;
+  for (; slots > 1; --slots)
+    timer->loss += (255 - timer->loss) >> 4;
+  timer->loss -= (timer->loss + 15) >> 4;
+
+  base = (timer->gapAvg >> 3) + timer->gapDev;
+  lossBase = heartbeats_needed(timer->loss, timer->interval) * timer->interval;
+  if (base < lossBase)
+    base = lossBase;
+
+  if (base < MIN_TICKS)
+    base = MIN_TICKS;
+  if (base > MAX_TICKS)
+    base = MAX_TICKS;
+
+  timer->base = base;
+  raise_floor(timer);
+
+}
+
+
+
+clock_time_t raft_timer_draw(struct ElectionTimer *timer) {
+
+  //random_rand() scaled onto 0 ... base - 1 with a multiply and a shift
+  uint32_t r = (uint32_t)random_rand() & 0xffff;
+
+  timer->timeout = timer->base + (clock_time_t)((r * timer->base) >> 16);
+
+  return timer->timeout;
+
+}
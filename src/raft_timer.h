@@ -0,0 +1,106 @@
+/******************************
+
+* Raft Election Timer
+
+* Election timeouts in clock ticks instead of whole seconds. Followers
+* time the gaps between frames from their leader and keep, in integer
+* fixed point, a smoothed mean and mean deviation of them (the TCP
+* retransmission estimator) and the share of heartbeats lost. The base
+* timeout covers mean + 4 * deviation for jitter, and enough heartbeats
+* that losing all of them is a 2^-20 event at the measured loss, kept
+* between RAFT_ELECTION_MIN_MS and RAFT_ELECTION_MAX_MS. A clean link
+* settles at the floor, a lossy one backs off instead of flapping. Each
+* restart draws a fresh timeout from base ... 2 * base so candidates
+* rarely collide. Every AppendEntries announces how long the leader may
+* stay quiet until its next frame; with RAFT_LOW_POWER an idle leader
+* stretches that up to RAFT_HEARTBEAT_MS << RAFT_IDLE_SHIFT, gaps are
+* counted in the announced interval and the base never falls below
+* three of them.
+
+*******************************/
+
+#ifndef RAFT_TIMER_H_
+#define RAFT_TIMER_H_
+
+#include "contiki.h"
+
+#include <stdint.h>
+
+#ifndef RAFT_LOW_POWER
+#define RAFT_LOW_POWER 0 //1 when the radio duty cycles with ContikiMAC, see project-conf.h
+#endif
+
+#if RAFT_LOW_POWER
+#include "net/netstack.h"
+
+//ContikiMAC strobes a broadcast for one whole wake-up interval
+#define RAFT_WAKEUP_MS (1000 / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#endif
+
+#ifndef RAFT_HEARTBEAT_MS
+#if RAFT_LOW_POWER
+#define RAFT_HEARTBEAT_MS (2 * RAFT_WAKEUP_MS) //whole wake-up intervals, so one heartbeat's strobe ends before the next
+#else
+#define RAFT_HEARTBEAT_MS 150 //leader heartbeat interval
+#endif
+#endif
+
+#ifndef RAFT_IDLE_SHIFT
+#if RAFT_LOW_POWER
+#define RAFT_IDLE_SHIFT 3 //an idle leader doubles its heartbeat interval up to RAFT_HEARTBEAT_MS << 3
+#else
+#define RAFT_IDLE_SHIFT 0
+#endif
+#endif
+
+#ifndef RAFT_ELECTION_MIN_MS
+#define RAFT_ELECTION_MIN_MS (3 * RAFT_HEARTBEAT_MS) //floor of the base, a lost heartbeat never times out
+#endif
+
+#ifndef RAFT_ELECTION_MAX_MS
+#define RAFT_ELECTION_MAX_MS 8000 //ceiling of the base on very lossy links
+#endif
+
+//failover stays bounded by RAFT_ELECTION_MAX_MS with the leader idle too
+#if 3 * (RAFT_HEARTBEAT_MS << RAFT_IDLE_SHIFT) > RAFT_ELECTION_MAX_MS
+#error "RAFT_HEARTBEAT_MS << RAFT_IDLE_SHIFT leaves no room for three heartbeats in RAFT_ELECTION_MAX_MS"
+#endif
+
+#define RAFT_TIMER_LOSS_PRIOR 32 //assume 1/8 of heartbeats are lost until the link shows otherwise
+
+//rounded up so no interval becomes 0 ticks
+#define RAFT_MS_TO_TICKS(ms) ((clock_time_t)(((uint32_t)(ms) * CLOCK_SECOND + 999) / 1000))
+
+//heartbeat interval a leader announces with idle, 0 ... RAFT_IDLE_SHIFT
+#define RAFT_BEAT_TICKS(idle) RAFT_MS_TO_TICKS((uint32_t)RAFT_HEARTBEAT_MS << (idle))
+
+struct ElectionTimer {
+
+  clock_time_t base;      //current base timeout
+
+  clock_time_t timeout;   //drawn for the running timer, base ... 2 * base - 1
+
+  clock_time_t lastHeard; //last frame from leader
+
+  clock_time_t interval;  //longest gap to the next frame the leader announced with it
+
+  unsigned short int leader; //whose gaps are being timed, 0 for nobody yet
+
+  uint32_t gapAvg;        //8 * mean gap
+
+  uint32_t gapDev;        //4 * mean deviation of the gap, 0 with gapAvg before the first sample
+
+  uint8_t loss;           //share of heartbeats lost, in 1/256, starts out at RAFT_TIMER_LOSS_PRIOR
+
+};
+
+void raft_timer_init(struct ElectionTimer *timer);
+
+//a frame from leader arrived at now announcing its next one within
+//RAFT_BEAT_TICKS(idle), a gap between two frames of the same leader is a sample
+void raft_timer_heard(struct ElectionTimer *timer, unsigned short int leader, clock_time_t now, uint8_t idle);
+
+//draws the timeout for the next restart
+clock_time_t raft_timer_draw(struct ElectionTimer *timer);
+
+#endif /* RAFT_TIMER_H_ */
@@ -0,0 +1,67 @@
+/******************************
+
+* Raft Tracing
+
+*******************************/
+
+#include "contiki.h"
+
+#include "raft_trace.h"
+
+
+
+#if RAFT_TRACE_RING > 0
+
+static const char * const eventNames[trace_events_count] = {
+  "boot", "follower", "candidate", "leader", "vote", "commit", "truncate",
+  "snapshot", "install", "repair", "step_down", "storage_error", "drop",
+  "pre_vote", "config"
+};
+
+//the last RAFT_TRACE_RING events, traceHead is the slot written next
+static struct TraceEvent traceRing[RAFT_TRACE_RING];
+
+static uint16_t traceHead;
+
+static uint16_t traceKept;
+
+static uint16_t traceSeq;
+
+
+
+void raft_trace_event(uint8_t event, uint8_t peer, uint32_t term, uint32_t index) {
+
+  struct TraceEvent *e = &traceRing[traceHead];
+
+  e->time = clock_time();
+  e->term = term;
+  e->index = index;
+  e->event = event;
+  e->peer = peer;
+  e->seq = traceSeq++;
+
+  traceHead = (traceHead + 1) % RAFT_TRACE_RING;
+  if (traceKept < RAFT_TRACE_RING)
+    ++traceKept;
+
+}
+
+
+
+void raft_trace_dump(void) {
+
+  uint16_t i;
+
+  printf("TRACE DUMP: {events: %u, kept: %u}\n", traceSeq, traceKept);
+
+  for (i = 0; i < traceKept; ++i) {
+    struct TraceEvent *e = &traceRing[(traceHead + RAFT_TRACE_RING - traceKept + i) % RAFT_TRACE_RING];
+
+    printf("TRACE: {seq: %u, time: %lu, event: %s, peer: %u, term: %lu, index: %lu}\n", \
+      e->seq, (unsigned long)e->time, e->event < trace_events_count ? eventNames[e->event] : "?", \
+      e->peer, (unsigned long)e->term, (unsigned long)e->index);
+  }
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+/******************************
+
+* Raft Tracing
+
+* printf tracing in three levels. Everything above RAFT_TRACE_LEVEL
+* expands to nothing, arguments included, and so do the *_print helpers
+* of raft.h below the debug level, so a quiet build pays nothing for
+* them. Independently of the level, RAFT_TRACE_RING keeps the last
+* protocol events (state changes, votes, commits, snapshots, repairs,
+* failures) as fixed size binary records in RAM, for raft_trace_dump()
+* to print on demand or a debugger to read out after the fact.
+
+*******************************/
+
+#ifndef RAFT_TRACE_H_
+#define RAFT_TRACE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define RAFT_TRACE_NONE  0
+#define RAFT_TRACE_ERROR 1 //storage failures, dropped frames
+#define RAFT_TRACE_INFO  2 //state changes, elections, commits, snapshots
+#define RAFT_TRACE_DEBUG 3 //every message sent and received
+
+#ifndef RAFT_TRACE_LEVEL
+#define RAFT_TRACE_LEVEL RAFT_TRACE_DEBUG
+#endif
+
+#ifndef RAFT_TRACE_RING
+#define RAFT_TRACE_RING 0 //events kept in RAM, 0 leaves the ring out
+#endif
+
+#if RAFT_TRACE_LEVEL >= RAFT_TRACE_ERROR
+#define TRACE_ERROR(...) printf(__VA_ARGS__)
+#else
+#define TRACE_ERROR(...)
+#endif
+
+#if RAFT_TRACE_LEVEL >= RAFT_TRACE_INFO
+#define TRACE_INFO(...) printf(__VA_ARGS__)
+#else
+#define TRACE_INFO(...)
+#endif
+
+#if RAFT_TRACE_LEVEL >= RAFT_TRACE_DEBUG
+#define TRACE_DEBUG(...) printf(__VA_ARGS__)
+#else
+#define TRACE_DEBUG(...)
+#endif
+
+enum trace_events {
+  trace_boot,          //term, lastLogIndex after recovery
+  trace_follower,      //term, lastLogIndex
+  trace_candidate,     //term, lastLogIndex
+  trace_leader,        //term, lastLogIndex
+  trace_vote,          //term, lastLogIndex, peer is the candidate we voted for
+  trace_commit,        //term, new commit index, peer is the ack that completed an overheard quorum
+  trace_truncate,      //term, first index removed
+  trace_snapshot,      //lastTerm, lastIndex of the snapshot taken
+  trace_install,       //lastTerm, lastIndex of the snapshot installed
+  trace_repair,        //term, nextIndex, peer is the follower
+  trace_step_down,     //newer term, lastLogIndex, peer reported it
+  trace_storage_error, //term, index being written
+  trace_drop,          //term, frame length, peer is the sender
+  trace_pre_vote,      //term asked for, lastLogIndex, peer is the pre-candidate we granted or 0 for our own round
+  trace_config,        //term, index of the latest configuration change, voters changed
+  trace_events_count
+};
+
+// one ring record, 16 bytes
+
+struct TraceEvent {
+
+  uint32_t time;  //clock_time() ticks, wraps with clock_time_t
+
+  uint32_t term;
+
+  uint32_t index;
+
+  uint8_t event;  //enum trace_events
+
+  uint8_t peer;   //node the event involves, 0 for none
+
+  uint16_t seq;   //running count, shows where the ring wrapped
+
+};
+
+#if RAFT_TRACE_RING > 0
+
+#define TRACE_EVENT(event, peer, term, index) raft_trace_event(event, peer, term, index)
+
+void raft_trace_event(uint8_t event, uint8_t peer, uint32_t term, uint32_t index);
+
+//prints the ring oldest first, one event per line
+void raft_trace_dump(void);
+
+#else
+
+#define TRACE_EVENT(event, peer, term, index)
+
+#endif
+
+#endif /* RAFT_TRACE_H_ */
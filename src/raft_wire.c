@@ -0,0 +1,481 @@
+/******************************
+
+* Raft Wire Format
+
+*******************************/
+
+#include "contiki.h"
+
+#include "raft.h"
+
+
+
+#include <string.h>
+
+
+
+// CURSORS
+
+void wire_writer_init(struct WireWriter *w, uint8_t *buf, uint16_t size) {
+
+  w->p = buf;
+  w->end = buf + size;
+  w->ok = 1;
+
+}
+
+void wire_write_byte(struct WireWriter *w, uint8_t v) {
+
+  if (!w->ok || w->p >= w->end) {
+    w->ok = 0;
+    return;
+  }
+
+  *w->p++ = v;
+
+}
+
+void wire_write_varint(struct WireWriter *w, uint32_t v) {
+
+  while (v >= 0x80) {
+    wire_write_byte(w, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+
+  wire_write_byte(w, (uint8_t)v);
+
+}
+
+void wire_write_bytes(struct WireWriter *w, const uint8_t *src, uint16_t len) {
+
+  if (!w->ok || w->end - w->p < len) {
+    w->ok = 0;
+    return;
+  }
+
+  memcpy(w->p, src, len);
+  w->p += len;
+
+}
+
+uint16_t wire_writer_space(struct WireWriter *w) {
+
+  return w->ok ? w->end - w->p : 0;
+
+}
+
+uint16_t wire_writer_len(struct WireWriter *w, uint8_t *buf) {
+
+  return w->ok ? w->p - buf : 0;
+
+}
+
+
+
+void wire_reader_init(struct WireReader *r, const uint8_t *buf, uint16_t len) {
+
+  r->p = buf;
+  r->end = buf + len;
+  r->ok = 1;
+
+}
+
+uint8_t wire_read_byte(struct WireReader *r) {
+
+  if (!r->ok || r->p >= r->end) {
+    r->ok = 0;
+    return 0;
+  }
+
+  return *r->p++;
+
+}
+
+uint32_t wire_read_varint(struct WireReader *r) {
+
+  uint32_t v = 0;
+  uint8_t shift = 0;
+  uint8_t b;
+
+  do {
+    b = wire_read_byte(r);
+
+    //a sixth byte, or bits beyond 32 in the fifth, is a corrupt frame
+    if (shift == 28 && (b & 0xf0) != 0)
+      r->ok = 0;
+    if (!r->ok)
+      return 0;
+
+    v |= (uint32_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+
+  return v;
+
+}
+
+const uint8_t *wire_read_ptr(struct WireReader *r, uint16_t len) {
+
+  const uint8_t *p = r->p;
+
+  if (!r->ok || r->end - r->p < len) {
+    r->ok = 0;
+    return NULL;
+  }
+
+  r->p += len;
+
+  return p;
+
+}
+
+
+
+// HEADER
+
+static void write_header(struct WireWriter *w, uint8_t type, uint8_t bType, \
+  uint32_t term, unsigned short int from) {
+
+  wire_write_byte(w, WIRE_TAG(type, bType));
+  wire_write_varint(w, term);
+  wire_write_varint(w, from);
+
+}
+
+//fills the common fields, fails when the tag is not the expected type
+
+static bool read_header(struct WireReader *r, struct Msg *msg, uint8_t type) {
+
+  uint8_t tag = wire_read_byte(r);
+
+  msg->type = WIRE_TAG_TYPE(tag);
+  msg->bType = WIRE_TAG_UNICAST(tag) ? unicast_msg : broadcast_msg;
+  msg->term = wire_read_varint(r);
+  msg->from = wire_read_varint(r);
+
+  return r->ok && msg->type == type;
+
+}
+
+bool decode_msg(const uint8_t *buf, uint16_t len, struct Msg *msg) {
+
+  struct WireReader r;
+
+  wire_reader_init(&r, buf, len);
+
+  if (len == 0)
+    return false;
+
+  return read_header(&r, msg, WIRE_TAG_TYPE(buf[0]));
+
+}
+
+
+
+// BUILDERS, each writes one frame of at most RAFT_MAX_PAYLOAD bytes and
+// returns its length
+
+uint16_t build_election(uint8_t *buf, uint8_t type, uint32_t term, unsigned short int from, \
+  uint32_t lastLogIndex, uint32_t lastLogTerm) {
+
+  struct WireWriter w;
+
+  wire_writer_init(&w, buf, RAFT_MAX_PAYLOAD);
+
+  write_header(&w, type, broadcast_msg, term, from);
+  wire_write_varint(&w, lastLogIndex);
+  wire_write_varint(&w, lastLogTerm);
+
+  return wire_writer_len(&w, buf);
+
+}
+
+
+
+uint16_t build_vote(uint8_t *buf, uint8_t type, uint32_t term, unsigned short int from, \
+  unsigned short int voteFor, bool voteGranted) {
+
+  struct WireWriter w;
+
+  wire_writer_init(&w, buf, RAFT_MAX_PAYLOAD);
+
+  write_header(&w, type, unicast_msg, term, from);
+  wire_write_varint(&w, voteFor);
+  wire_write_byte(&w, voteGranted);
+
+  return wire_writer_len(&w, buf);
+
+}
+
+
+
+uint16_t build_append_entries(uint8_t *buf, uint32_t term, unsigned short int from, \
+  uint32_t prevLogIndex, uint32_t prevLogTerm, uint32_t leaderCommit, uint8_t idle, \
+  struct RaftLog *log, uint8_t *count) {
+
+  struct WireWriter w;
+  struct LogEntry *first = *count > 0 ? raft_log_get(log, prevLogIndex + 1) : NULL;
+  uint32_t entryTerm = first != NULL ? first->term : 0;
+  uint8_t entryKind = first != NULL ? first->kind : raft_entry_data;
+  uint8_t *countByte;
+  uint8_t i = 0;
+
+  wire_writer_init(&w, buf, RAFT_MAX_PAYLOAD);
+
+  write_header(&w, append, broadcast_msg, term, from);
+  wire_write_varint(&w, prevLogIndex);
+  wire_write_varint(&w, prevLogTerm);
+  wire_write_varint(&w, leaderCommit);
+  wire_write_varint(&w, entryTerm);
+  wire_write_byte(&w, entryKind);
+  wire_write_byte(&w, idle);
+
+  countByte = w.p;
+  wire_write_byte(&w, 0);
+
+  //entries prevLogIndex + 1 ... as many as fit, the ring may wrap in between
+  //and the batch ends where the term or the kind of entry changes, or at
+  //an entry the log no longer holds: a start before log.firstIndex gets an
+  //empty batch, the caller sends InstallSnapshot for those
+  for (; i < *count && wire_writer_space(&w) > 0; ++i) {
+    struct LogEntry *entry = raft_log_get(log, prevLogIndex + 1 + i);
+
+    if (entry == NULL || entry->term != entryTerm || entry->kind != entryKind)
+      break;
+
+    wire_write_byte(&w, entry->value);
+  }
+
+  if (w.ok)
+    *countByte = i;
+  *count = i;
+
+  return wire_writer_len(&w, buf);
+
+}
+
+
+
+uint16_t build_response(uint8_t *buf, uint32_t commitIndex, uint32_t term, \
+  unsigned short int from, uint32_t prevLogIndex, uint32_t prevLogTerm, bool success) {
+
+  struct WireWriter w;
+
+  wire_writer_init(&w, buf, RAFT_MAX_PAYLOAD);
+
+  write_header(&w, respond, unicast_msg, term, from);
+  wire_write_varint(&w, commitIndex);
+  wire_write_varint(&w, prevLogIndex);
+  wire_write_varint(&w, prevLogTerm);
+  wire_write_byte(&w, success);
+
+  return wire_writer_len(&w, buf);
+
+}
+
+
+
+uint16_t build_install_snapshot(uint8_t *buf, uint32_t term, unsigned short int from, \
+  unsigned short int to, struct Snapshot *snapshot, uint16_t offset) {
+
+  struct WireWriter w;
+  uint16_t count = 0;
+
+  wire_writer_init(&w, buf, RAFT_MAX_PAYLOAD);
+
+  write_header(&w, install_snapshot, unicast_msg, term, from);
+  wire_write_varint(&w, to);
+  wire_write_varint(&w, snapshot->lastIndex);
+  wire_write_varint(&w, snapshot->lastTerm);
+  wire_write_varint(&w, snapshot->voters);
+  wire_write_varint(&w, offset);
+  wire_write_varint(&w, snapshot->len);
+
+  //as much of the image as fits after the count byte
+  if (offset < snapshot->len && wire_writer_space(&w) > 1) {
+    count = snapshot->len - offset;
+    if (count > wire_writer_space(&w) - 1)
+      count = wire_writer_space(&w) - 1;
+  }
+
+  wire_write_byte(&w, count);
+  wire_write_bytes(&w, snapshot->data + offset, count);
+
+  return wire_writer_len(&w, buf);
+
+}
+
+
+
+uint16_t build_snapshot_response(uint8_t *buf, uint32_t term, unsigned short int from, \
+  uint32_t lastIndex, uint16_t offset) {
+
+  struct WireWriter w;
+
+  wire_writer_init(&w, buf, RAFT_MAX_PAYLOAD);
+
+  write_header(&w, snapshot_ack, unicast_msg, term, from);
+  wire_write_varint(&w, lastIndex);
+  wire_write_varint(&w, offset);
+
+  return wire_writer_len(&w, buf);
+
+}
+
+
+
+// DECODERS, false for a frame of another type, a truncated frame or one
+// with trailing bytes. Entries and snapshot data are left in the frame, the
+// decoded struct points at them and is valid as long as the frame is
+
+bool decode_election(const uint8_t *buf, uint16_t len, struct Election *elect) {
+
+  struct WireReader r;
+  struct Msg msg;
+
+  wire_reader_init(&r, buf, len);
+
+  //a pre_election has the same layout
+  if (!read_header(&r, &msg, len > 0 && WIRE_TAG_TYPE(buf[0]) == pre_election ? pre_election : election))
+    return false;
+
+  elect->type = msg.type;
+  elect->bType = msg.bType;
+  elect->term = msg.term;
+  elect->from = msg.from;
+  elect->lastLogIndex = wire_read_varint(&r);
+  elect->lastLogTerm = wire_read_varint(&r);
+
+  return r.ok && r.p == r.end;
+
+}
+
+
+
+bool decode_vote(const uint8_t *buf, uint16_t len, struct Vote *voteMsg) {
+
+  struct WireReader r;
+  struct Msg msg;
+
+  wire_reader_init(&r, buf, len);
+
+  //and so does a pre_vote
+  if (!read_header(&r, &msg, len > 0 && WIRE_TAG_TYPE(buf[0]) == pre_vote ? pre_vote : vote))
+    return false;
+
+  voteMsg->type = msg.type;
+  voteMsg->bType = msg.bType;
+  voteMsg->term = msg.term;
+  voteMsg->from = msg.from;
+  voteMsg->voteFor = wire_read_varint(&r);
+  voteMsg->voteGranted = wire_read_byte(&r) ? true : false;
+
+  return r.ok && r.p == r.end;
+
+}
+
+
+
+bool decode_append_entries(const uint8_t *buf, uint16_t len, struct AppendEntries *appendMsg) {
+
+  struct WireReader r;
+  struct Msg msg;
+
+  wire_reader_init(&r, buf, len);
+
+  if (!read_header(&r, &msg, append))
+    return false;
+
+  appendMsg->type = msg.type;
+  appendMsg->bType = msg.bType;
+  appendMsg->term = msg.term;
+  appendMsg->from = msg.from;
+  appendMsg->prevLogIndex = wire_read_varint(&r);
+  appendMsg->prevLogTerm = wire_read_varint(&r);
+  appendMsg->leaderCommit = wire_read_varint(&r);
+  appendMsg->entryTerm = wire_read_varint(&r);
+  appendMsg->entryKind = wire_read_byte(&r);
+  appendMsg->idle = wire_read_byte(&r);
+  appendMsg->count = wire_read_byte(&r);
+  appendMsg->entries = wire_read_ptr(&r, appendMsg->count);
+
+  return r.ok && r.p == r.end;
+
+}
+
+
+
+bool decode_response(const uint8_t *buf, uint16_t len, struct Response *response) {
+
+  struct WireReader r;
+  struct Msg msg;
+
+  wire_reader_init(&r, buf, len);
+
+  if (!read_header(&r, &msg, respond))
+    return false;
+
+  response->type = msg.type;
+  response->bType = msg.bType;
+  response->term = msg.term;
+  response->from = msg.from;
+  response->commitIndex = wire_read_varint(&r);
+  response->prevLogIndex = wire_read_varint(&r);
+  response->prevLogTerm = wire_read_varint(&r);
+  response->success = wire_read_byte(&r) ? true : false;
+
+  return r.ok && r.p == r.end;
+
+}
+
+
+
+bool decode_install_snapshot(const uint8_t *buf, uint16_t len, struct InstallSnapshot *chunk) {
+
+  struct WireReader r;
+  struct Msg msg;
+
+  wire_reader_init(&r, buf, len);
+
+  if (!read_header(&r, &msg, install_snapshot))
+    return false;
+
+  chunk->type = msg.type;
+  chunk->bType = msg.bType;
+  chunk->term = msg.term;
+  chunk->from = msg.from;
+  chunk->to = wire_read_varint(&r);
+  chunk->lastIndex = wire_read_varint(&r);
+  chunk->lastTerm = wire_read_varint(&r);
+  chunk->voters = wire_read_varint(&r);
+  chunk->offset = wire_read_varint(&r);
+  chunk->total = wire_read_varint(&r);
+  chunk->count = wire_read_byte(&r);
+  chunk->data = wire_read_ptr(&r, chunk->count);
+
+  return r.ok && r.p == r.end;
+
+}
+
+
+
+bool decode_snapshot_response(const uint8_t *buf, uint16_t len, struct SnapshotResponse *response) {
+
+  struct WireReader r;
+  struct Msg msg;
+
+  wire_reader_init(&r, buf, len);
+
+  if (!read_header(&r, &msg, snapshot_ack))
+    return false;
+
+  response->type = msg.type;
+  response->bType = msg.bType;
+  response->term = msg.term;
+  response->from = msg.from;
+  response->lastIndex = wire_read_varint(&r);
+  response->offset = wire_read_varint(&r);
+
+  return r.ok && r.p == r.end;
+
+}
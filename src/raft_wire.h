@@ -0,0 +1,71 @@
+/******************************
+
+* Raft Wire Format
+
+* Messages are serialized field by field instead of casting structs onto
+* packetbuf. Every frame starts with a one byte tag (message type, high
+* bit set for unicast), followed by the term and the sender id. Terms,
+* indices and ids are unsigned LEB128 varints (1 byte below 128, at most
+* 5), so frames carry no padding and have the same layout on every
+* compiler. Readers and writers are bounds checked: once a field runs
+* past the end of the buffer the cursor fails and stays failed.
+
+*******************************/
+
+#ifndef RAFT_WIRE_H_
+#define RAFT_WIRE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WIRE_VARINT_MAX 5 //bytes of the largest uint32_t varint
+
+#define WIRE_TAG(type, bType) ((uint8_t)((type) | ((bType) == unicast_msg ? 0x80 : 0)))
+#define WIRE_TAG_TYPE(tag) ((tag) & 0x7f)
+#define WIRE_TAG_UNICAST(tag) (((tag) & 0x80) != 0)
+
+struct WireWriter {
+
+  uint8_t *p;
+
+  uint8_t *end;
+
+  uint8_t ok;
+
+};
+
+struct WireReader {
+
+  const uint8_t *p;
+
+  const uint8_t *end;
+
+  uint8_t ok;
+
+};
+
+void wire_writer_init(struct WireWriter *w, uint8_t *buf, uint16_t size);
+
+void wire_write_byte(struct WireWriter *w, uint8_t v);
+
+void wire_write_varint(struct WireWriter *w, uint32_t v);
+
+void wire_write_bytes(struct WireWriter *w, const uint8_t *src, uint16_t len);
+
+//bytes still free
+uint16_t wire_writer_space(struct WireWriter *w);
+
+//bytes written, 0 when anything did not fit
+uint16_t wire_writer_len(struct WireWriter *w, uint8_t *buf);
+
+void wire_reader_init(struct WireReader *r, const uint8_t *buf, uint16_t len);
+
+//the readers return 0 once the cursor has failed
+uint8_t wire_read_byte(struct WireReader *r);
+
+uint32_t wire_read_varint(struct WireReader *r);
+
+//skips len bytes and returns where they start in the frame, NULL if they are not all there
+const uint8_t *wire_read_ptr(struct WireReader *r, uint16_t len);
+
+#endif /* RAFT_WIRE_H_ */
@@ -0,0 +1,295 @@
+/******************************
+
+* Raft Simulator Channel
+
+*******************************/
+
+#include "channel.h"
+
+#include <stdlib.h>
+
+#include <string.h>
+
+
+/*---------------------------------------------------------------------------*/
+
+static uint64_t splitmix64(uint64_t *x) {
+
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+
+}
+
+static double uniform(uint64_t *x) {
+
+  return (splitmix64(x) >> 11) * (1.0 / 9007199254740992.0);
+
+}
+
+static int node_index(long id) {
+
+  return id >= 1 && id <= CHANNEL_MAX_NODES ? (int)(id - 1) : -1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+void channel_init(struct channel *c) {
+
+  int i, j;
+
+  memset(c, 0, sizeof(*c));
+
+  for (i = 0; i < CHANNEL_MAX_NODES; ++i)
+    for (j = 0; j < CHANNEL_MAX_NODES; ++j)
+      c->prr[i][j] = 1;
+
+  c->burstLoss = 1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+void channel_reset(struct channel *c, uint64_t seed) {
+
+  memset(c->bad, 0, sizeof(c->bad));
+  memset(c->air, 0, sizeof(c->air));
+  c->tx = 0;
+
+  c->rng = seed ^ 0x5851f42d4c957f2dULL;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+int channel_parse_link(struct channel *c, const char *spec) {
+
+  char *end;
+  long from, to;
+  double prr;
+
+  from = strtol(spec, &end, 10);
+  if (*end != ':')
+    return 0;
+
+  to = strtol(end + 1, &end, 10);
+  if (*end != ':')
+    return 0;
+
+  prr = strtod(end + 1, &end);
+  if (*end != '\0' || prr < 0 || prr > 1)
+    return 0;
+
+  if (node_index(from) < 0 || node_index(to) < 0 || from == to)
+    return 0;
+
+  c->prr[node_index(from)][node_index(to)] = (float)prr;
+
+  return 1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+int channel_parse_partition(struct channel *c, const char *spec) {
+
+  struct channel_partition p = {0, 0, 0};
+  char *end;
+  double start, stop;
+
+  if (c->partitionCount == CHANNEL_PARTITIONS)
+    return 0;
+
+  start = strtod(spec, &end);
+  if (*end != '-')
+    return 0;
+
+  stop = strtod(end + 1, &end);
+  if (*end != ':' || start < 0 || stop <= start)
+    return 0;
+
+  do {
+    long id = strtol(end + 1, &end, 10);
+    if (node_index(id) < 0)
+      return 0;
+    p.group |= 1ULL << node_index(id);
+  } while (*end == ',');
+
+  if (*end != '\0')
+    return 0;
+
+  p.start = (uint64_t)(start * 1e6);
+  p.end = (uint64_t)(stop * 1e6);
+  c->partitions[c->partitionCount++] = p;
+
+  return 1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+int channel_parse_burst(struct channel *c, const char *spec) {
+
+  char *end;
+  double enter, leave, loss = 1;
+
+  enter = strtod(spec, &end);
+  if (*end != ',')
+    return 0;
+
+  leave = strtod(end + 1, &end);
+  if (*end == ',')
+    loss = strtod(end + 1, &end);
+
+  if (*end != '\0' || enter < 0 || enter > 1 || leave <= 0 || leave > 1 || loss < 0 || loss > 1)
+    return 0;
+
+  c->burstEnter = enter;
+  c->burstLeave = leave;
+  c->burstLoss = loss;
+
+  return 1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//a slot in use whose transmission shares air time with [start, end)
+static int overlaps(const struct channel_air *a, uint64_t start, uint64_t end) {
+
+  return a->src != 0 && start < a->end && a->start < end;
+
+}
+
+static uint64_t gap(uint64_t a, uint64_t b) {
+
+  return a > b ? a - b : b - a;
+
+}
+
+uint64_t channel_transmit(struct channel *c, uint64_t ready, uint64_t airtime, int src,
+                          uint32_t *tx) {
+
+  struct channel_air *slot;
+  uint64_t start = ready;
+  int backoffs = 0;
+  int busy = 1;
+  int i;
+
+  *tx = c->tx++;
+
+  if (!c->contention)
+    return start;
+
+  //back off while the air is busy with a transmission we would hear, or
+  //one that would hear us in time and was decided first. Starts only move
+  //later, so this ends
+  while (busy) {
+    busy = 0;
+    for (i = 0; i < CHANNEL_AIR && !busy; ++i) {
+      const struct channel_air *a = &c->air[i];
+      busy = a->src != src + 1 && overlaps(a, start, start + airtime) &&
+        gap(a->start, start) >= CHANNEL_CCA_US;
+    }
+    if (busy)
+      start += channel_backoff(c, ++backoffs);
+  }
+
+  slot = &c->air[*tx % CHANNEL_AIR];
+  slot->start = start;
+  slot->end = start + airtime;
+  slot->tx = *tx;
+  slot->src = (uint16_t)(src + 1);
+  slot->collided = 0;
+
+  //whatever is left overlapping started too close to sense
+  for (i = 0; i < CHANNEL_AIR; ++i) {
+    struct channel_air *a = &c->air[i];
+    if (a != slot && a->src != slot->src && overlaps(a, slot->start, slot->end)) {
+      a->collided = 1;
+      slot->collided = 1;
+    }
+  }
+
+  return start;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+uint64_t channel_backoff(struct channel *c, int retries) {
+
+  int window = retries < CHANNEL_BACKOFF_WINDOW ? retries : CHANNEL_BACKOFF_WINDOW;
+
+  ++c->retries;
+
+  return CHANNEL_BACKOFF_US + splitmix64(&c->rng) % (window * CHANNEL_BACKOFF_US);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+int channel_collided(struct channel *c, uint32_t tx) {
+
+  const struct channel_air *a = &c->air[tx % CHANNEL_AIR];
+
+  if (a->src == 0 || a->tx != tx || !a->collided)
+    return 0;
+
+  ++c->collided;
+
+  return 1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+int channel_deliver(struct channel *c, uint64_t now, int src, int dst, uint64_t *delays) {
+
+  uint8_t *bad = &c->bad[src][dst];
+  double loss;
+  int copies = 1;
+  int i;
+
+  for (i = 0; i < c->partitionCount; ++i) {
+    const struct channel_partition *p = &c->partitions[i];
+    if (now >= p->start && now < p->end &&
+        ((p->group >> src) & 1) != ((p->group >> dst) & 1)) {
+      ++c->cut;
+      return 0;
+    }
+  }
+
+  //the chain steps once per frame on the link, before it decides this one
+  if (c->burstEnter > 0) {
+    if (*bad)
+      *bad = uniform(&c->rng) >= c->burstLeave;
+    else
+      *bad = uniform(&c->rng) < c->burstEnter;
+  }
+
+  loss = *bad ? c->burstLoss : c->loss;
+
+  if ((loss > 0 && uniform(&c->rng) < loss) ||
+      (c->prr[src][dst] < 1 && uniform(&c->rng) >= c->prr[src][dst])) {
+    ++c->lost;
+    return 0;
+  }
+
+  if (c->duplicate > 0 && uniform(&c->rng) < c->duplicate) {
+    ++c->duplicated;
+    copies = 2;
+  }
+
+  for (i = 0; i < copies; ++i)
+    delays[i] = c->reorder > 0 ? (uint64_t)(uniform(&c->rng) * (c->reorder + 1)) : 0;
+
+  return copies;
+
+}
+
+/*---------------------------------------------------------------------------*/
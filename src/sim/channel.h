@@ -0,0 +1,138 @@
+/******************************
+
+* Raft Simulator Channel
+
+* What happens to a frame between the sender's radio and each receiver.
+* Every directed link has its own reception ratio and a Gilbert-Elliott
+* chain: in the good state a frame is lost with the base loss, in the bad
+* state with the burst loss, and the chain moves between the two once per
+* frame, so losses come in bursts as on a real 802.15.4 link. A frame that
+* gets through can arrive twice, and every copy can be held back by up to
+* a bound, which reorders frames on the same link. Scripted partitions
+* cut a group of nodes off from the rest for a while and heal it again.
+* With contention on, every node hears every transmission. A sender that
+* finds the air busy backs off as Contiki's csma over nullrdc does, but two
+* that start within one clear channel assessment of each other both go out
+* and collide, and neither frame reaches anyone. The simulator sends a
+* collided unicast again after the same backoff, as csma does without a
+* link-layer ack; a broadcast is not acked and simply lost.
+* With nothing configured the channel is the ideal bus.
+
+*******************************/
+
+#ifndef CHANNEL_H_
+#define CHANNEL_H_
+
+#include <stdint.h>
+
+#define CHANNEL_MAX_NODES 64   //same as SIM_MAX_NODES
+#define CHANNEL_PARTITIONS 16
+#define CHANNEL_COPIES 2       //a frame and its duplicate
+#define CHANNEL_AIR 256        //recent transmissions contention looks at
+#define CHANNEL_CCA_US 320     //a transmission is heard this long after it starts
+#define CHANNEL_BACKOFF_US 125000 //csma's time base, CLOCK_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE
+#define CHANNEL_BACKOFF_WINDOW 3 //a backoff adds up to this many time bases, fewer on the first tries
+#define CHANNEL_RETRIES 3      //MAC retransmissions of a collided unicast
+
+struct channel_partition {
+
+  uint64_t start;              //microseconds
+
+  uint64_t end;                //heals here
+
+  uint64_t group;              //bit i for node id i + 1, cut off from the others
+
+};
+
+struct channel_air {
+
+  uint64_t start;              //microseconds
+
+  uint64_t end;
+
+  uint32_t tx;                 //id from channel_transmit
+
+  uint16_t src;                //node index + 1, 0 for an unused slot
+
+  uint8_t collided;
+
+};
+
+struct channel {
+
+  double loss;                 //base loss, the good state's
+
+  double burstEnter;           //good to bad per frame, 0 keeps every link good
+
+  double burstLeave;           //bad to good per frame
+
+  double burstLoss;            //loss in the bad state
+
+  double duplicate;            //chance a received frame arrives twice
+
+  uint64_t reorder;            //microseconds a copy can be held back
+
+  float prr[CHANNEL_MAX_NODES][CHANNEL_MAX_NODES]; //[from][to], 1 unless set
+
+  uint8_t bad[CHANNEL_MAX_NODES][CHANNEL_MAX_NODES]; //Gilbert-Elliott state
+
+  struct channel_partition partitions[CHANNEL_PARTITIONS];
+
+  int partitionCount;
+
+  int contention;              //1 lets transmissions of different nodes collide
+
+  struct channel_air air[CHANNEL_AIR]; //by tx % CHANNEL_AIR
+
+  uint32_t tx;                 //transmissions this run
+
+  uint64_t rng;
+
+  //stats
+
+  uint64_t lost;
+
+  uint64_t cut;                //lost to a partition
+
+  uint64_t duplicated;
+
+  uint64_t collided;           //frames not received because of a collision
+
+  uint64_t retries;            //backoffs for a busy channel or a collided unicast
+
+};
+
+//ideal links, keeps nothing from before
+void channel_init(struct channel *c);
+
+//back to the good state and a fresh random stream, for the next run
+void channel_reset(struct channel *c, uint64_t seed);
+
+//"from:to:prr" with node ids, e.g. 1:2:0.6, 0 on a malformed spec
+int channel_parse_link(struct channel *c, const char *spec);
+
+//"start-end:id,id,..." in seconds, e.g. 100-160:1,2, 0 on a malformed spec
+int channel_parse_partition(struct channel *c, const char *spec);
+
+//"enter,leave[,loss]" per frame probabilities, the loss defaults to 1
+int channel_parse_burst(struct channel *c, const char *spec);
+
+//start of a transmission of airtime microseconds from node index src
+//that is ready at ready, and its id in *tx for channel_collided. Without
+//contention it starts when ready
+uint64_t channel_transmit(struct channel *c, uint64_t ready, uint64_t airtime, int src,
+                          uint32_t *tx);
+
+//random wait before the retries-th try after the first, one time base
+//and a random part of up to retries more, counted in retries
+uint64_t channel_backoff(struct channel *c, int retries);
+
+//1 when a frame of transmission tx is lost to a collision, counted
+//once per receiver
+int channel_collided(struct channel *c, uint32_t tx);
+
+//copies of a frame sent from node index src at now that reach dst, 0 to
+//CHANNEL_COPIES, with the delay of each in delays
+int channel_deliver(struct channel *c, uint64_t now, int src, int dst, uint64_t *delays);
+
+#endif /* CHANNEL_H_ */
@@ -0,0 +1,224 @@
+/******************************
+
+* Contiki shim for the host simulator
+
+* Mirrors the subset of the Contiki 3.0 process, protothread, clock and
+* timer APIs that the Raft node uses, so raft.c and raft_node.c compile
+* unchanged into a host mote library (see sim/mote.c).
+
+*******************************/
+
+#ifndef CONTIKI_H_
+#define CONTIKI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/* clock */
+
+typedef unsigned long clock_time_t;
+
+#define CLOCK_SECOND 128 //same tick rate as the sky platform
+
+#define CLOCK_LT(a, b) ((long)((a) - (b)) < 0)
+
+clock_time_t clock_time(void);
+
+unsigned long clock_seconds(void);
+
+/*---------------------------------------------------------------------------*/
+/* printf, the mote's own (sim/mote.c). The Makefile turns off gcc's builtin
+   so calls are not rewritten to puts, this keeps -Wformat checking them */
+
+int printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/*---------------------------------------------------------------------------*/
+/* protothreads (switch based local continuations) */
+
+typedef unsigned short lc_t;
+
+#define LC_INIT(s) s = 0;
+#define LC_RESUME(s) switch(s) { case 0:
+#define LC_SET(s) s = __LINE__; case __LINE__:
+#define LC_END(s) }
+
+struct pt {
+  lc_t lc;
+};
+
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+
+#define PT_THREAD(name_args) char name_args
+#define PT_INIT(pt) LC_INIT((pt)->lc)
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; if (PT_YIELD_FLAG) {;} LC_RESUME((pt)->lc)
+#define PT_END(pt) LC_END((pt)->lc); PT_YIELD_FLAG = 0; \
+                   PT_INIT(pt); return PT_ENDED; }
+
+#define PT_WAIT_UNTIL(pt, condition)      \
+  do {                                    \
+    LC_SET((pt)->lc);                     \
+    if(!(condition)) {                    \
+      return PT_WAITING;                  \
+    }                                     \
+  } while(0)
+
+#define PT_YIELD(pt)                      \
+  do {                                    \
+    PT_YIELD_FLAG = 0;                    \
+    LC_SET((pt)->lc);                     \
+    if(PT_YIELD_FLAG == 0) {              \
+      return PT_YIELDED;                  \
+    }                                     \
+  } while(0)
+
+#define PT_YIELD_UNTIL(pt, cond)          \
+  do {                                    \
+    PT_YIELD_FLAG = 0;                    \
+    LC_SET((pt)->lc);                     \
+    if((PT_YIELD_FLAG == 0) || !(cond)) { \
+      return PT_YIELDED;                  \
+    }                                     \
+  } while(0)
+
+#define PT_EXIT(pt)                       \
+  do {                                    \
+    PT_INIT(pt);                          \
+    return PT_EXITED;                     \
+  } while(0)
+
+/*---------------------------------------------------------------------------*/
+/* processes */
+
+typedef unsigned char process_event_t;
+typedef void *process_data_t;
+typedef unsigned char process_num_events_t;
+
+#define PROCESS_ERR_OK   0
+#define PROCESS_ERR_FULL 1
+
+#define PROCESS_NONE NULL
+#define PROCESS_BROADCAST NULL
+
+#define PROCESS_EVENT_NONE            0x80
+#define PROCESS_EVENT_INIT            0x81
+#define PROCESS_EVENT_POLL            0x82
+#define PROCESS_EVENT_EXIT            0x83
+#define PROCESS_EVENT_SERVICE_REMOVED 0x84
+#define PROCESS_EVENT_CONTINUE        0x85
+#define PROCESS_EVENT_MSG             0x86
+#define PROCESS_EVENT_EXITED          0x87
+#define PROCESS_EVENT_TIMER           0x88
+#define PROCESS_EVENT_COM             0x89
+#define PROCESS_EVENT_MAX             0x8a
+
+#ifndef PROCESS_CONF_NUMEVENTS
+#define PROCESS_CONF_NUMEVENTS 32
+#endif
+
+struct process {
+  struct process *next;
+  const char *name;
+  PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
+  struct pt pt;
+  unsigned char state, needspoll;
+};
+
+#define PROCESS_THREAD(name, ev, data)                    \
+static PT_THREAD(process_thread_##name(struct pt *process_pt, \
+                                       process_event_t ev,    \
+                                       process_data_t data))
+
+#define PROCESS_NAME(name) extern struct process name
+
+#define PROCESS(name, strname)                            \
+  PROCESS_THREAD(name, ev, data);                         \
+  struct process name = { NULL, strname,                  \
+                          process_thread_##name }
+
+#define PROCESS_BEGIN()             PT_BEGIN(process_pt)
+#define PROCESS_END()               PT_END(process_pt)
+#define PROCESS_WAIT_EVENT()        PROCESS_YIELD()
+#define PROCESS_WAIT_EVENT_UNTIL(c) PROCESS_YIELD_UNTIL(c)
+#define PROCESS_YIELD()             PT_YIELD(process_pt)
+#define PROCESS_YIELD_UNTIL(c)      PT_YIELD_UNTIL(process_pt, c)
+#define PROCESS_WAIT_UNTIL(c)       PT_WAIT_UNTIL(process_pt, c)
+#define PROCESS_EXIT()              PT_EXIT(process_pt)
+
+#define PROCESS_PAUSE()                                   \
+  do {                                                    \
+    process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL); \
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE); \
+  } while(0)
+
+#define PROCESS_EXITHANDLER(handler) if(ev == PROCESS_EVENT_EXIT) { handler; }
+#define PROCESS_POLLHANDLER(handler) if(ev == PROCESS_EVENT_POLL) { handler; }
+
+#define PROCESS_CURRENT() process_current
+#define PROCESS_CONTEXT_BEGIN(p) { \
+  struct process *tmp_current = PROCESS_CURRENT(); \
+  process_current = p
+#define PROCESS_CONTEXT_END(p) process_current = tmp_current; }
+
+#define AUTOSTART_PROCESSES(...) \
+  struct process * const autostart_processes[] = {__VA_ARGS__, NULL}
+
+extern struct process *process_current;
+
+void process_init(void);
+void process_start(struct process *p, process_data_t data);
+void process_exit(struct process *p);
+int process_post(struct process *p, process_event_t ev, process_data_t data);
+void process_post_synch(struct process *p, process_event_t ev, process_data_t data);
+void process_poll(struct process *p);
+int process_run(void);
+int process_is_running(struct process *p);
+int process_nevents(void);
+process_event_t process_alloc_event(void);
+
+/*---------------------------------------------------------------------------*/
+/* timers */
+
+struct timer {
+  clock_time_t start;
+  clock_time_t interval;
+};
+
+void timer_set(struct timer *t, clock_time_t interval);
+void timer_reset(struct timer *t);
+void timer_restart(struct timer *t);
+int timer_expired(struct timer *t);
+clock_time_t timer_remaining(struct timer *t);
+
+struct etimer {
+  struct timer timer;
+  struct etimer *next;
+  struct process *p;
+};
+
+void etimer_set(struct etimer *et, clock_time_t interval);
+void etimer_reset(struct etimer *et);
+void etimer_restart(struct etimer *et);
+void etimer_stop(struct etimer *et);
+int etimer_expired(struct etimer *et);
+int etimer_pending(void);
+clock_time_t etimer_next_expiration_time(void);
+
+struct ctimer {
+  struct ctimer *next;
+  struct etimer etimer;
+  struct process *p;
+  void (*f)(void *);
+  void *ptr;
+};
+
+void ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr);
+void ctimer_reset(struct ctimer *c);
+void ctimer_restart(struct ctimer *c);
+void ctimer_stop(struct ctimer *c);
+int ctimer_expired(struct ctimer *c);
+
+#endif /* CONTIKI_H_ */
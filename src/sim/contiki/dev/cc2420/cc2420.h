@@ -0,0 +1,4 @@
+/* shim: the simulated radio needs no driver declarations */
+#ifndef CC2420_H_
+#define CC2420_H_
+#endif /* CC2420_H_ */
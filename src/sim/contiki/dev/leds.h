@@ -0,0 +1,17 @@
+/* shim: led state is reported to the simulator (see sim/mote.c) */
+#ifndef LEDS_H_
+#define LEDS_H_
+
+#define LEDS_GREEN  1
+#define LEDS_YELLOW 2
+#define LEDS_RED    4
+#define LEDS_BLUE   LEDS_YELLOW
+#define LEDS_ALL    7
+
+void leds_init(void);
+unsigned char leds_get(void);
+void leds_on(unsigned char leds);
+void leds_off(unsigned char leds);
+void leds_toggle(unsigned char leds);
+
+#endif /* LEDS_H_ */
@@ -0,0 +1,10 @@
+/* shim: the simulated radio is always on, only the ContikiMAC wake-up
+   rate is here so RAFT_LOW_POWER builds time their heartbeats the same */
+#ifndef NETSTACK_H_
+#define NETSTACK_H_
+
+#ifndef NETSTACK_RDC_CHANNEL_CHECK_RATE
+#define NETSTACK_RDC_CHANNEL_CHECK_RATE 8
+#endif
+
+#endif /* NETSTACK_H_ */
@@ -0,0 +1,2 @@
+/* shim: everything lives in net/rime/rime.h */
+#include "net/rime/rime.h"
@@ -0,0 +1,114 @@
+/******************************
+
+* Rime shim for the host simulator
+
+* Link addresses, the packet buffer and the broadcast and unicast
+* primitives. Frames leave the mote through the simulator's virtual
+* radio bus instead of a radio driver.
+
+*******************************/
+
+#ifndef RIME_H_
+#define RIME_H_
+
+#include "contiki.h"
+
+/*---------------------------------------------------------------------------*/
+/* link addresses */
+
+#define LINKADDR_SIZE 2
+
+typedef union {
+  unsigned char u8[LINKADDR_SIZE];
+  uint16_t u16;
+} linkaddr_t;
+
+extern linkaddr_t linkaddr_node_addr;
+extern const linkaddr_t linkaddr_null;
+
+void linkaddr_copy(linkaddr_t *dest, const linkaddr_t *from);
+int linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2);
+void linkaddr_set_node_addr(linkaddr_t *addr);
+
+/*---------------------------------------------------------------------------*/
+/* packet buffer */
+
+#define PACKETBUF_SIZE 128
+#define PACKETBUF_HDR_SIZE 48
+
+typedef uint16_t packetbuf_attr_t;
+
+enum {
+  PACKETBUF_ATTR_NONE,
+  PACKETBUF_ATTR_CHANNEL,
+  PACKETBUF_ATTR_RSSI,
+  PACKETBUF_ATTR_LINK_QUALITY,
+  PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+  PACKETBUF_ATTR_MAC_SEQNO,
+
+  PACKETBUF_ADDR_SENDER,
+  PACKETBUF_ADDR_RECEIVER,
+  PACKETBUF_ADDR_ESENDER,
+  PACKETBUF_ADDR_ERECEIVER,
+
+  PACKETBUF_ATTR_MAX
+};
+
+#define PACKETBUF_ADDR_FIRST PACKETBUF_ADDR_SENDER
+
+void packetbuf_clear(void);
+void *packetbuf_dataptr(void);
+void *packetbuf_hdrptr(void);
+uint16_t packetbuf_datalen(void);
+uint16_t packetbuf_totlen(void);
+void packetbuf_set_datalen(uint16_t len);
+int packetbuf_copyfrom(const void *from, uint16_t len);
+int packetbuf_copyto(void *to);
+int packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val);
+packetbuf_attr_t packetbuf_attr(uint8_t type);
+int packetbuf_set_addr(uint8_t type, const linkaddr_t *addr);
+const linkaddr_t *packetbuf_addr(uint8_t type);
+
+/*---------------------------------------------------------------------------*/
+/* connections */
+
+struct channel {
+  struct channel *next;
+  uint16_t channelno;
+};
+
+struct broadcast_conn;
+
+struct broadcast_callbacks {
+  void (* recv)(struct broadcast_conn *ptr, const linkaddr_t *sender);
+  void (* sent)(struct broadcast_conn *ptr, int status, int num_tx);
+};
+
+struct broadcast_conn {
+  struct channel channel;
+  const struct broadcast_callbacks *u;
+};
+
+void broadcast_open(struct broadcast_conn *c, uint16_t channel,
+                    const struct broadcast_callbacks *u);
+void broadcast_close(struct broadcast_conn *c);
+int broadcast_send(struct broadcast_conn *c);
+
+struct unicast_conn;
+
+struct unicast_callbacks {
+  void (* recv)(struct unicast_conn *c, const linkaddr_t *from);
+  void (* sent)(struct unicast_conn *ptr, int status, int num_tx);
+};
+
+struct unicast_conn {
+  struct channel channel;
+  const struct unicast_callbacks *u;
+};
+
+void unicast_open(struct unicast_conn *c, uint16_t channel,
+                  const struct unicast_callbacks *u);
+void unicast_close(struct unicast_conn *c);
+int unicast_send(struct unicast_conn *c, const linkaddr_t *receiver);
+
+#endif /* RIME_H_ */
@@ -0,0 +1,7 @@
+/* shim: node_id is assigned by the simulator at boot */
+#ifndef NODE_ID_H_
+#define NODE_ID_H_
+
+extern unsigned short node_id;
+
+#endif /* NODE_ID_H_ */
@@ -0,0 +1,24 @@
+/* shim: radio and CPU time as the simulator models it (see sim/mote.c) */
+#ifndef ENERGEST_H_
+#define ENERGEST_H_
+
+#ifndef ENERGEST_CONF_ON
+#define ENERGEST_CONF_ON 1
+#endif
+
+enum energest_type {
+  ENERGEST_TYPE_CPU,
+  ENERGEST_TYPE_LPM,
+  ENERGEST_TYPE_IRQ,
+  ENERGEST_TYPE_LED_GREEN,
+  ENERGEST_TYPE_LED_YELLOW,
+  ENERGEST_TYPE_LED_RED,
+  ENERGEST_TYPE_TRANSMIT,
+  ENERGEST_TYPE_LISTEN,
+  ENERGEST_TYPE_MAX
+};
+
+void energest_flush(void);
+unsigned long energest_type_time(int type);
+
+#endif /* ENERGEST_H_ */
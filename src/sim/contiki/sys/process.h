@@ -0,0 +1,2 @@
+/* shim: everything lives in contiki.h */
+#include "contiki.h"
@@ -0,0 +1,7 @@
+/* shim: rtimer tick rate of the sky platform, only used to scale Energest */
+#ifndef RTIMER_H_
+#define RTIMER_H_
+
+#define RTIMER_SECOND 32768UL
+
+#endif /* RTIMER_H_ */
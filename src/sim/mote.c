@@ -0,0 +1,1287 @@
+/******************************
+
+* Raft Simulator Mote
+
+* Host implementation of the Contiki services used by the Raft node:
+* processes, clock, etimer/ctimer, packetbuf, Rime broadcast/unicast,
+* leds, random, a RAM backed CFS, Energest and node_id. Linked together with raft.c and raft_node.c
+* into raft-mote.so; the simulator swaps the library's writable data
+* between motes, so everything here is plain static state just like on
+* a real mote.
+
+*******************************/
+
+#include "contiki.h"
+
+#include "net/rime/rime.h"
+
+#include "dev/leds.h"
+
+#include "lib/random.h"
+
+#include "cfs/cfs.h"
+
+#include "sys/energest.h"
+
+#include "sys/rtimer.h"
+
+#include "net/netstack.h"
+
+#include "node-id.h"
+
+#include "mote.h"
+
+#include "raft.h"
+
+
+
+#include <stdarg.h>
+
+#include <string.h>
+
+
+#define MOTE_MAX_STEPS 10000 //guards against a process that never blocks
+
+
+static const struct mote_hooks *hooks;
+
+static void *hooks_ctx;
+
+static int log_enabled;
+
+static clock_time_t current_clock;
+
+unsigned short node_id;
+
+extern struct process * const autostart_processes[];
+
+
+
+/*---------------------------------------------------------------------------*/
+/* clock */
+
+clock_time_t clock_time(void) {
+
+  return current_clock;
+
+}
+
+unsigned long clock_seconds(void) {
+
+  return current_clock / CLOCK_SECOND;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* processes, a trimmed down copy of core/sys/process.c */
+
+#define PROCESS_STATE_NONE    0
+#define PROCESS_STATE_RUNNING 1
+#define PROCESS_STATE_CALLED  2
+
+struct event_data {
+  process_event_t ev;
+  process_data_t data;
+  struct process *p;
+};
+
+struct process *process_list;
+
+struct process *process_current;
+
+static process_event_t lastevent;
+
+static process_num_events_t nevents, fevent;
+
+static struct event_data events[PROCESS_CONF_NUMEVENTS];
+
+static unsigned char poll_requested;
+
+static void remove_etimers(struct process *p);
+
+static void call_process(struct process *p, process_event_t ev, process_data_t data);
+
+process_event_t process_alloc_event(void) {
+
+  return lastevent++;
+
+}
+
+void process_init(void) {
+
+  lastevent = PROCESS_EVENT_MAX;
+
+  nevents = fevent = 0;
+
+  poll_requested = 0;
+
+  process_current = process_list = NULL;
+
+}
+
+void process_start(struct process *p, process_data_t data) {
+
+  struct process *q;
+
+  for (q = process_list; q != p && q != NULL; q = q->next);
+
+  if (q == p)
+    return;
+
+  p->next = process_list;
+  process_list = p;
+  p->state = PROCESS_STATE_RUNNING;
+  PT_INIT(&p->pt);
+
+  process_post_synch(p, PROCESS_EVENT_INIT, data);
+
+}
+
+static void exit_process(struct process *p, struct process *fromprocess) {
+
+  struct process *q;
+  struct process *old_current = process_current;
+
+  if (!process_is_running(p))
+    return;
+
+  p->state = PROCESS_STATE_NONE;
+
+  if (p != fromprocess && p->thread != NULL) {
+    process_current = p;
+    p->thread(&p->pt, PROCESS_EVENT_EXIT, NULL);
+  }
+
+  if (p == process_list) {
+    process_list = process_list->next;
+  }
+  else {
+    for (q = process_list; q != NULL; q = q->next) {
+      if (q->next == p) {
+        q->next = p->next;
+        break;
+      }
+    }
+  }
+
+  remove_etimers(p);
+
+  process_current = old_current;
+
+}
+
+static void call_process(struct process *p, process_event_t ev, process_data_t data) {
+
+  int ret;
+
+  if ((p->state & PROCESS_STATE_RUNNING) && p->thread != NULL) {
+    process_current = p;
+    p->state = PROCESS_STATE_CALLED;
+    ret = p->thread(&p->pt, ev, data);
+    if (ret == PT_EXITED || ret == PT_ENDED || ev == PROCESS_EVENT_EXIT)
+      exit_process(p, p);
+    else
+      p->state = PROCESS_STATE_RUNNING;
+  }
+
+}
+
+void process_exit(struct process *p) {
+
+  exit_process(p, PROCESS_CURRENT());
+
+}
+
+int process_post(struct process *p, process_event_t ev, process_data_t data) {
+
+  process_num_events_t snum;
+
+  if (nevents == PROCESS_CONF_NUMEVENTS)
+    return PROCESS_ERR_FULL;
+
+  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
+  events[snum].ev = ev;
+  events[snum].data = data;
+  events[snum].p = p;
+  ++nevents;
+
+  return PROCESS_ERR_OK;
+
+}
+
+void process_post_synch(struct process *p, process_event_t ev, process_data_t data) {
+
+  struct process *caller = process_current;
+
+  call_process(p, ev, data);
+  process_current = caller;
+
+}
+
+void process_poll(struct process *p) {
+
+  if (p != NULL && (p->state == PROCESS_STATE_RUNNING || p->state == PROCESS_STATE_CALLED)) {
+    p->needspoll = 1;
+    poll_requested = 1;
+  }
+
+}
+
+int process_is_running(struct process *p) {
+
+  return p->state != PROCESS_STATE_NONE;
+
+}
+
+int process_nevents(void) {
+
+  return nevents + poll_requested;
+
+}
+
+static void do_poll(void) {
+
+  struct process *p;
+
+  poll_requested = 0;
+
+  for (p = process_list; p != NULL; p = p->next) {
+    if (p->needspoll) {
+      p->state = PROCESS_STATE_RUNNING;
+      p->needspoll = 0;
+      call_process(p, PROCESS_EVENT_POLL, NULL);
+    }
+  }
+
+}
+
+static void do_event(void) {
+
+  struct event_data e;
+  struct process *p;
+
+  if (nevents == 0)
+    return;
+
+  e = events[fevent];
+  fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+  --nevents;
+
+  if (e.p == PROCESS_BROADCAST) {
+    for (p = process_list; p != NULL; p = p->next) {
+      if (poll_requested)
+        do_poll();
+      call_process(p, e.ev, e.data);
+    }
+  }
+  else {
+    if (e.ev == PROCESS_EVENT_INIT)
+      e.p->state = PROCESS_STATE_RUNNING;
+    call_process(e.p, e.ev, e.data);
+  }
+
+}
+
+int process_run(void) {
+
+  if (poll_requested)
+    do_poll();
+
+  do_event();
+
+  return nevents + poll_requested;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* timers */
+
+static struct etimer *timerlist;
+
+static struct ctimer *ctimerlist;
+
+void timer_set(struct timer *t, clock_time_t interval) {
+
+  t->interval = interval;
+  t->start = clock_time();
+
+}
+
+void timer_reset(struct timer *t) {
+
+  t->start += t->interval;
+
+}
+
+void timer_restart(struct timer *t) {
+
+  t->start = clock_time();
+
+}
+
+int timer_expired(struct timer *t) {
+
+  clock_time_t diff = (clock_time() - t->start) + 1;
+
+  return t->interval < diff;
+
+}
+
+clock_time_t timer_remaining(struct timer *t) {
+
+  return t->start + t->interval - clock_time();
+
+}
+
+static void remove_etimer(struct etimer *et) {
+
+  struct etimer *t;
+
+  if (timerlist == et) {
+    timerlist = et->next;
+  }
+  else {
+    for (t = timerlist; t != NULL; t = t->next) {
+      if (t->next == et) {
+        t->next = et->next;
+        break;
+      }
+    }
+  }
+
+  et->next = NULL;
+
+}
+
+static void add_etimer(struct etimer *et) {
+
+  remove_etimer(et);
+  et->p = PROCESS_CURRENT();
+  et->next = timerlist;
+  timerlist = et;
+
+}
+
+static void remove_etimers(struct process *p) {
+
+  struct etimer *t = timerlist;
+
+  while (t != NULL) {
+    struct etimer *next = t->next;
+    if (t->p == p) {
+      remove_etimer(t);
+      t->p = PROCESS_NONE;
+    }
+    t = next;
+  }
+
+}
+
+void etimer_set(struct etimer *et, clock_time_t interval) {
+
+  timer_set(&et->timer, interval);
+  add_etimer(et);
+
+}
+
+void etimer_reset(struct etimer *et) {
+
+  timer_reset(&et->timer);
+  add_etimer(et);
+
+}
+
+void etimer_restart(struct etimer *et) {
+
+  timer_restart(&et->timer);
+  add_etimer(et);
+
+}
+
+void etimer_stop(struct etimer *et) {
+
+  remove_etimer(et);
+  et->p = PROCESS_NONE;
+
+}
+
+int etimer_expired(struct etimer *et) {
+
+  return et->p == PROCESS_NONE;
+
+}
+
+int etimer_pending(void) {
+
+  return timerlist != NULL;
+
+}
+
+clock_time_t etimer_next_expiration_time(void) {
+
+  struct etimer *t;
+  clock_time_t next = 0;
+  int found = 0;
+
+  for (t = timerlist; t != NULL; t = t->next) {
+    clock_time_t when = t->timer.start + t->timer.interval;
+    if (!found || CLOCK_LT(when, next)) {
+      next = when;
+      found = 1;
+    }
+  }
+
+  return next;
+
+}
+
+static void remove_ctimer(struct ctimer *c) {
+
+  struct ctimer *t;
+
+  if (ctimerlist == c) {
+    ctimerlist = c->next;
+  }
+  else {
+    for (t = ctimerlist; t != NULL; t = t->next) {
+      if (t->next == c) {
+        t->next = c->next;
+        break;
+      }
+    }
+  }
+
+  c->next = NULL;
+
+}
+
+static void add_ctimer(struct ctimer *c) {
+
+  remove_ctimer(c);
+  c->etimer.p = c->p != NULL ? c->p : (struct process *)&ctimerlist; //marks pending
+  c->next = ctimerlist;
+  ctimerlist = c;
+
+}
+
+void ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr) {
+
+  c->p = PROCESS_CURRENT();
+  c->f = f;
+  c->ptr = ptr;
+  timer_set(&c->etimer.timer, t);
+  add_ctimer(c);
+
+}
+
+void ctimer_reset(struct ctimer *c) {
+
+  timer_reset(&c->etimer.timer);
+  add_ctimer(c);
+
+}
+
+void ctimer_restart(struct ctimer *c) {
+
+  timer_restart(&c->etimer.timer);
+  add_ctimer(c);
+
+}
+
+void ctimer_stop(struct ctimer *c) {
+
+  remove_ctimer(c);
+  c->etimer.p = PROCESS_NONE;
+
+}
+
+int ctimer_expired(struct ctimer *c) {
+
+  return c->etimer.p == PROCESS_NONE;
+
+}
+
+//posts timer events and runs callbacks for everything due, returns 1 if anything fired
+static int fire_timers(void) {
+
+  struct etimer *et;
+  struct ctimer *c;
+  int fired = 0;
+
+  for (et = timerlist; et != NULL; ) {
+    struct etimer *next = et->next;
+    if (timer_expired(&et->timer) &&
+        process_post(et->p, PROCESS_EVENT_TIMER, et) == PROCESS_ERR_OK) {
+      remove_etimer(et);
+      et->p = PROCESS_NONE;
+      fired = 1;
+    }
+    et = next;
+  }
+
+  //callbacks may re-arm or stop any ctimer, so rescan from the head each time
+  for (c = ctimerlist; c != NULL; ) {
+    if (timer_expired(&c->etimer.timer)) {
+      remove_ctimer(c);
+      c->etimer.p = PROCESS_NONE;
+      PROCESS_CONTEXT_BEGIN(c->p);
+      c->f(c->ptr);
+      PROCESS_CONTEXT_END(c->p);
+      fired = 1;
+      c = ctimerlist;
+    }
+    else {
+      c = c->next;
+    }
+  }
+
+  return fired;
+
+}
+
+static int next_expiry(unsigned long *next) {
+
+  struct ctimer *c;
+  clock_time_t when;
+  int found = etimer_pending();
+
+  if (found)
+    *next = etimer_next_expiration_time();
+
+  for (c = ctimerlist; c != NULL; c = c->next) {
+    when = c->etimer.timer.start + c->etimer.timer.interval;
+    if (!found || CLOCK_LT(when, *next)) {
+      *next = when;
+      found = 1;
+    }
+  }
+
+  return found;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* leds */
+
+static unsigned char leds;
+
+void leds_init(void) {
+
+  leds = 0;
+
+}
+
+unsigned char leds_get(void) {
+
+  return leds;
+
+}
+
+static void leds_update(unsigned char new_leds) {
+
+  if (new_leds != leds) {
+    leds = new_leds;
+    if (hooks->leds != NULL)
+      hooks->leds(hooks_ctx, leds);
+  }
+
+}
+
+void leds_on(unsigned char l) {
+
+  leds_update(leds | l);
+
+}
+
+void leds_off(unsigned char l) {
+
+  leds_update(leds & ~l);
+
+}
+
+void leds_toggle(unsigned char l) {
+
+  leds_update(leds ^ l);
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* random, same LCG on every mote so runs only depend on the seed */
+
+static uint32_t rand_seed;
+
+void random_init(unsigned short seed) {
+
+  rand_seed = seed;
+
+}
+
+unsigned short random_rand(void) {
+
+  rand_seed = rand_seed * 1664525UL + 1013904223UL;
+
+  return (unsigned short)(rand_seed >> 16);
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* CFS, a handful of fixed size files in mote RAM. Opening for writing
+   without CFS_APPEND truncates, like the POSIX backed CFS of native builds */
+
+#define CFS_FILES     5 //state, two log files and their two snapshots
+#define CFS_FILE_SIZE 1024
+#define CFS_NAME_SIZE 16
+#define CFS_FDS       4
+
+struct cfs_file {
+  char name[CFS_NAME_SIZE];
+  uint16_t len;
+  uint8_t data[CFS_FILE_SIZE];
+};
+
+struct cfs_fd {
+  struct cfs_file *file;
+  uint16_t offset;
+  int flags;
+};
+
+static struct cfs_file files[CFS_FILES];
+
+static struct cfs_fd fds[CFS_FDS];
+
+static struct cfs_file *cfs_find(const char *name) {
+
+  int i;
+
+  for (i = 0; i < CFS_FILES; ++i)
+    if (files[i].name[0] != '\0' && strncmp(files[i].name, name, CFS_NAME_SIZE) == 0)
+      return &files[i];
+
+  return NULL;
+
+}
+
+int cfs_open(const char *name, int flags) {
+
+  struct cfs_file *file = cfs_find(name);
+  int fd, i;
+
+  for (fd = 0; fd < CFS_FDS && fds[fd].file != NULL; ++fd);
+
+  if (fd == CFS_FDS || strlen(name) >= CFS_NAME_SIZE)
+    return -1;
+
+  if (file == NULL) {
+    if (!(flags & CFS_WRITE))
+      return -1;
+    for (i = 0; i < CFS_FILES && files[i].name[0] != '\0'; ++i);
+    if (i == CFS_FILES)
+      return -1;
+    file = &files[i];
+    strcpy(file->name, name);
+    file->len = 0;
+  }
+
+  if ((flags & CFS_WRITE) && !(flags & CFS_APPEND))
+    file->len = 0;
+
+  fds[fd].file = file;
+  fds[fd].offset = (flags & CFS_APPEND) ? file->len : 0;
+  fds[fd].flags = flags;
+
+  return fd;
+
+}
+
+void cfs_close(int fd) {
+
+  if (fd >= 0 && fd < CFS_FDS)
+    fds[fd].file = NULL;
+
+}
+
+int cfs_read(int fd, void *buf, unsigned int len) {
+
+  struct cfs_fd *f;
+
+  if (fd < 0 || fd >= CFS_FDS || fds[fd].file == NULL || !(fds[fd].flags & CFS_READ))
+    return -1;
+
+  f = &fds[fd];
+  if (len > f->file->len - f->offset)
+    len = f->file->len - f->offset;
+
+  memcpy(buf, f->file->data + f->offset, len);
+  f->offset += len;
+
+  return len;
+
+}
+
+int cfs_write(int fd, const void *buf, unsigned int len) {
+
+  struct cfs_fd *f;
+
+  if (fd < 0 || fd >= CFS_FDS || fds[fd].file == NULL || !(fds[fd].flags & CFS_WRITE))
+    return -1;
+
+  f = &fds[fd];
+  if (len > CFS_FILE_SIZE - f->offset)
+    return -1;
+
+  memcpy(f->file->data + f->offset, buf, len);
+  f->offset += len;
+  if (f->file->len < f->offset)
+    f->file->len = f->offset;
+
+  return len;
+
+}
+
+cfs_offset_t cfs_seek(int fd, cfs_offset_t offset, int whence) {
+
+  struct cfs_fd *f;
+  cfs_offset_t base = 0;
+
+  if (fd < 0 || fd >= CFS_FDS || fds[fd].file == NULL)
+    return -1;
+
+  f = &fds[fd];
+  if (whence == CFS_SEEK_CUR)
+    base = f->offset;
+  else if (whence == CFS_SEEK_END)
+    base = f->file->len;
+
+  if (base + offset < 0 || base + offset > f->file->len)
+    return -1;
+
+  f->offset = base + offset;
+
+  return f->offset;
+
+}
+
+int cfs_remove(const char *name) {
+
+  struct cfs_file *file = cfs_find(name);
+
+  if (file == NULL)
+    return -1;
+
+  file->name[0] = '\0';
+  file->len = 0;
+
+  return 0;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* printf, routed to the simulator log (the library is linked -Bsymbolic) */
+
+int printf(const char *fmt, ...) {
+
+  va_list ap;
+
+  if (!log_enabled || hooks->log == NULL)
+    return 0;
+
+  va_start(ap, fmt);
+  hooks->log(hooks_ctx, fmt, ap);
+  va_end(ap);
+
+  return 0;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* link addresses and packetbuf */
+
+linkaddr_t linkaddr_node_addr;
+
+const linkaddr_t linkaddr_null = {{0, 0}};
+
+void linkaddr_copy(linkaddr_t *dest, const linkaddr_t *from) {
+
+  memcpy(dest, from, LINKADDR_SIZE);
+
+}
+
+int linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2) {
+
+  return memcmp(addr1, addr2, LINKADDR_SIZE) == 0;
+
+}
+
+void linkaddr_set_node_addr(linkaddr_t *addr) {
+
+  linkaddr_copy(&linkaddr_node_addr, addr);
+
+}
+
+static uint16_t addr_to_id(const linkaddr_t *addr) {
+
+  return (uint16_t)(addr->u8[0] | (addr->u8[1] << 8));
+
+}
+
+static void id_to_addr(uint16_t id, linkaddr_t *addr) {
+
+  addr->u8[0] = id & 0xff;
+  addr->u8[1] = id >> 8;
+
+}
+
+static uint8_t packetbuf[PACKETBUF_HDR_SIZE + PACKETBUF_SIZE];
+
+static uint16_t buflen;
+
+static packetbuf_attr_t attrs[PACKETBUF_ADDR_FIRST];
+
+static linkaddr_t addrs[PACKETBUF_ATTR_MAX - PACKETBUF_ADDR_FIRST];
+
+void packetbuf_clear(void) {
+
+  buflen = 0;
+  memset(attrs, 0, sizeof(attrs));
+  memset(addrs, 0, sizeof(addrs));
+
+}
+
+void *packetbuf_dataptr(void) {
+
+  return packetbuf + PACKETBUF_HDR_SIZE;
+
+}
+
+void *packetbuf_hdrptr(void) {
+
+  return packetbuf + PACKETBUF_HDR_SIZE;
+
+}
+
+uint16_t packetbuf_datalen(void) {
+
+  return buflen;
+
+}
+
+uint16_t packetbuf_totlen(void) {
+
+  return buflen;
+
+}
+
+void packetbuf_set_datalen(uint16_t len) {
+
+  buflen = len > PACKETBUF_SIZE ? PACKETBUF_SIZE : len;
+
+}
+
+int packetbuf_copyfrom(const void *from, uint16_t len) {
+
+  uint16_t l;
+
+  packetbuf_clear();
+  l = len > PACKETBUF_SIZE ? PACKETBUF_SIZE : len;
+  memcpy(packetbuf_dataptr(), from, l);
+  buflen = l;
+
+  return l;
+
+}
+
+int packetbuf_copyto(void *to) {
+
+  memcpy(to, packetbuf_dataptr(), buflen);
+
+  return buflen;
+
+}
+
+int packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val) {
+
+  if (type < PACKETBUF_ADDR_FIRST)
+    attrs[type] = val;
+
+  return 1;
+
+}
+
+packetbuf_attr_t packetbuf_attr(uint8_t type) {
+
+  return type < PACKETBUF_ADDR_FIRST ? attrs[type] : 0;
+
+}
+
+int packetbuf_set_addr(uint8_t type, const linkaddr_t *addr) {
+
+  linkaddr_copy(&addrs[type - PACKETBUF_ADDR_FIRST], addr);
+
+  return 1;
+
+}
+
+const linkaddr_t *packetbuf_addr(uint8_t type) {
+
+  return &addrs[type - PACKETBUF_ADDR_FIRST];
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* energest, modelled from the frames sent and received: 32 us a byte at
+   250 kbit/s plus PHY, MAC and Rime headers, the CPU counted as asleep.
+   Without RAFT_LOW_POWER the radio listens whenever it does not send.
+   With it, ContikiMAC listens for a channel check every wake-up interval
+   and for each frame it receives, and strobes a broadcast for a whole
+   interval and a unicast for half of one until the receiver wakes */
+
+#ifndef RAFT_LOW_POWER
+#define RAFT_LOW_POWER 0
+#endif
+
+#define FRAME_OVERHEAD 37 //bytes on air besides the payload
+
+#define WAKEUP_TICKS (RTIMER_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+
+#define CHECK_TICKS (RTIMER_SECOND / 1000) //one channel check, about a millisecond
+
+static unsigned long energest_boot; //clock_time() at boot
+
+static unsigned long energest_transmit;
+
+static unsigned long energest_receive;
+
+static unsigned long energest_listen; //never runs backwards while a send is within one tick
+
+static unsigned long airtime(uint16_t len) {
+
+  return (len + FRAME_OVERHEAD) * 32UL * RTIMER_SECOND / 1000000UL;
+
+}
+
+static void energest_sent(uint16_t len, int broadcast) {
+
+  if (!RAFT_LOW_POWER)
+    energest_transmit += airtime(len);
+  else
+    energest_transmit += broadcast ? WAKEUP_TICKS : WAKEUP_TICKS / 2;
+
+}
+
+void energest_flush(void) {
+
+}
+
+unsigned long energest_type_time(int type) {
+
+  unsigned long up = (current_clock - energest_boot) * RTIMER_SECOND / CLOCK_SECOND;
+  unsigned long listen;
+
+  if (RAFT_LOW_POWER)
+    listen = up / WAKEUP_TICKS * CHECK_TICKS + energest_receive;
+  else
+    listen = up > energest_transmit ? up - energest_transmit : 0;
+
+  if (listen < energest_listen)
+    listen = energest_listen;
+  energest_listen = listen;
+
+  switch (type) {
+    case ENERGEST_TYPE_LPM:
+      return up;
+    case ENERGEST_TYPE_TRANSMIT:
+      return energest_transmit;
+    case ENERGEST_TYPE_LISTEN:
+      return listen;
+    default:
+      return 0;
+  }
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* rime */
+
+static struct broadcast_conn *broadcast_conns[4];
+
+static struct unicast_conn *unicast_conns[4];
+
+#define CONN_SLOTS (sizeof(broadcast_conns) / sizeof(broadcast_conns[0]))
+
+static void radio_send(uint16_t channel, uint16_t receiver) {
+
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  hooks->send(hooks_ctx, channel, receiver, packetbuf_dataptr(), packetbuf_datalen());
+  energest_sent(packetbuf_datalen(), receiver == MOTE_BROADCAST);
+
+}
+
+void broadcast_open(struct broadcast_conn *c, uint16_t channel,
+                    const struct broadcast_callbacks *u) {
+
+  unsigned int i;
+
+  c->channel.channelno = channel;
+  c->u = u;
+
+  for (i = 0; i < CONN_SLOTS; ++i) {
+    if (broadcast_conns[i] == NULL || broadcast_conns[i] == c) {
+      broadcast_conns[i] = c;
+      return;
+    }
+  }
+
+}
+
+void broadcast_close(struct broadcast_conn *c) {
+
+  unsigned int i;
+
+  for (i = 0; i < CONN_SLOTS; ++i) {
+    if (broadcast_conns[i] == c)
+      broadcast_conns[i] = NULL;
+  }
+
+}
+
+int broadcast_send(struct broadcast_conn *c) {
+
+  radio_send(c->channel.channelno, MOTE_BROADCAST);
+
+  if (c->u->sent != NULL)
+    c->u->sent(c, 0, 1);
+
+  return 1;
+
+}
+
+void unicast_open(struct unicast_conn *c, uint16_t channel,
+                  const struct unicast_callbacks *u) {
+
+  unsigned int i;
+
+  c->channel.channelno = channel;
+  c->u = u;
+
+  for (i = 0; i < CONN_SLOTS; ++i) {
+    if (unicast_conns[i] == NULL || unicast_conns[i] == c) {
+      unicast_conns[i] = c;
+      return;
+    }
+  }
+
+}
+
+void unicast_close(struct unicast_conn *c) {
+
+  unsigned int i;
+
+  for (i = 0; i < CONN_SLOTS; ++i) {
+    if (unicast_conns[i] == c)
+      unicast_conns[i] = NULL;
+  }
+
+}
+
+int unicast_send(struct unicast_conn *c, const linkaddr_t *receiver) {
+
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, receiver);
+  radio_send(c->channel.channelno, addr_to_id(receiver));
+
+  if (c->u->sent != NULL)
+    c->u->sent(c, 0, 1);
+
+  return 1;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* proposals of the simulator's client. The buffer handed to raft_propose
+   identifies the proposal in the callback, each slot remembers its tag
+   and is reused long after the leader settled it (RAFT_PROPOSAL_QUEUE) */
+
+#define PROPOSAL_SLOTS 256
+
+static uint8_t proposalData[PROPOSAL_SLOTS];
+
+static uint32_t proposalTags[PROPOSAL_SLOTS];
+
+static uint16_t proposalNext;
+
+static void proposal_done(const uint8_t *buf, uint32_t index, int committed) {
+
+  if (hooks->proposed != NULL)
+    hooks->proposed(hooks_ctx, proposalTags[buf - proposalData], index, committed);
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* state machine of every mote: the counter of raft.c, also reporting each
+   applied entry so the simulator sees when all motes have it */
+
+static uint32_t appliedCount;
+
+static uint32_t appliedSum;
+
+static void machine_apply(uint32_t index, uint8_t value) {
+
+  ++appliedCount;
+  appliedSum += value;
+
+  if (hooks->applied != NULL)
+    hooks->applied(hooks_ctx, index, value);
+
+}
+
+static uint16_t machine_save(uint8_t *buf, uint16_t size) {
+
+  if (size < 8)
+    return 0;
+
+  memcpy(buf, &appliedCount, 4);
+  memcpy(buf + 4, &appliedSum, 4);
+
+  return 8;
+
+}
+
+static void machine_restore(const uint8_t *buf, uint16_t len) {
+
+  appliedCount = 0;
+  appliedSum = 0;
+
+  if (len < 8)
+    return;
+
+  memcpy(&appliedCount, buf, 4);
+  memcpy(&appliedSum, buf + 4, 4);
+
+}
+
+static const struct StateMachine machine = {machine_apply, machine_save, machine_restore};
+
+/*---------------------------------------------------------------------------*/
+/* simulator entry points, see mote.h */
+
+static int mote_run(unsigned long now, unsigned long *next) {
+
+  int steps = 0;
+
+  current_clock = now;
+
+  do {
+    while (process_run() > 0 && ++steps < MOTE_MAX_STEPS);
+  } while (fire_timers() && ++steps < MOTE_MAX_STEPS);
+
+  return next_expiry(next);
+
+}
+
+void mote_bind(const struct mote_hooks *h, void *ctx, int log) {
+
+  hooks = h;
+  hooks_ctx = ctx;
+  log_enabled = log;
+
+}
+
+int mote_boot(uint16_t id, uint16_t seed, unsigned long now, unsigned long *next) {
+
+  int i;
+
+  current_clock = now;
+  node_id = id;
+  id_to_addr(id, &linkaddr_node_addr);
+  random_init(seed);
+  leds_init();
+  energest_boot = now;
+  energest_transmit = 0;
+  energest_receive = 0;
+  energest_listen = 0;
+  packetbuf_clear();
+  process_init();
+
+  //picked up by raft_init once the node process starts
+  raft_set_state_machine(&machine);
+
+  for (i = 0; autostart_processes[i] != NULL; ++i)
+    process_start(autostart_processes[i], NULL);
+
+  return mote_run(now, next);
+
+}
+
+int mote_input(uint16_t channel, uint16_t sender, uint16_t receiver,
+               const void *data, uint16_t len, unsigned long now,
+               unsigned long *next) {
+
+  linkaddr_t addr;
+  unsigned int i;
+
+  current_clock = now;
+  process_current = NULL;
+
+  packetbuf_copyfrom(data, len);
+  energest_receive += airtime(len);
+  id_to_addr(sender, &addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &addr);
+  id_to_addr(receiver, &addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+
+  if (receiver == MOTE_BROADCAST) {
+    for (i = 0; i < CONN_SLOTS; ++i) {
+      struct broadcast_conn *c = broadcast_conns[i];
+      if (c != NULL && c->channel.channelno == channel && c->u->recv != NULL) {
+        id_to_addr(sender, &addr);
+        c->u->recv(c, &addr);
+        break;
+      }
+    }
+  }
+  else if (receiver == node_id) {
+    for (i = 0; i < CONN_SLOTS; ++i) {
+      struct unicast_conn *c = unicast_conns[i];
+      if (c != NULL && c->channel.channelno == channel && c->u->recv != NULL) {
+        id_to_addr(sender, &addr);
+        c->u->recv(c, &addr);
+        break;
+      }
+    }
+  }
+
+  return mote_run(now, next);
+
+}
+
+int mote_poll(unsigned long now, unsigned long *next) {
+
+  return mote_run(now, next);
+
+}
+
+int mote_propose(uint32_t tag, unsigned long now) {
+
+  uint16_t slot = proposalNext;
+
+  current_clock = now;
+  process_current = NULL;
+
+  proposalTags[slot] = tag;
+  proposalData[slot] = (uint8_t)tag;
+
+  //a rejected proposal leaves its slot to the next, so only ever
+  //PROPOSAL_SLOTS accepted ones go round before a slot is reused
+  if (!raft_propose(&proposalData[slot], 1, proposal_done))
+    return 0;
+
+  proposalNext = (proposalNext + 1) % PROPOSAL_SLOTS;
+
+  return 1;
+
+}
+
+unsigned long mote_clock_second(void) {
+
+  return CLOCK_SECOND;
+
+}
@@ -0,0 +1,63 @@
+/******************************
+
+* Raft Simulator Mote Interface
+
+* Entry points exported by the mote library (raft.c, raft_node.c and the
+* Contiki shim in mote.c, built as raft-mote.so) and the hooks through
+* which a mote reaches the simulator. Only plain C types are used here so
+* the simulator never has to include the Contiki shim headers.
+
+*******************************/
+
+#ifndef MOTE_H_
+#define MOTE_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#define MOTE_FRAME_SIZE 128 //same as PACKETBUF_SIZE
+#define MOTE_BROADCAST 0    //receiver address of broadcast frames
+
+struct mote_hooks {
+  //frame handed to the radio, receiver is MOTE_BROADCAST for broadcasts
+  void (* send)(void *ctx, uint16_t channel, uint16_t receiver,
+                const void *data, uint16_t len);
+
+  //new LEDS_* bitmask
+  void (* leds)(void *ctx, unsigned char leds);
+
+  //printf output of the mote, only called when logging is enabled
+  void (* log)(void *ctx, const char *fmt, va_list ap);
+
+  //outcome of a proposal made with mote_propose, committed as raft_propose_cb
+  void (* proposed)(void *ctx, uint32_t tag, uint32_t index, int committed);
+
+  //the mote's state machine applied value, the data entry at index
+  void (* applied)(void *ctx, uint32_t index, uint8_t value);
+};
+
+//called once after loading, before any mote is booted
+typedef void (* mote_bind_fn)(const struct mote_hooks *hooks, void *ctx, int log);
+
+//all calls below take the current virtual time in clock ticks and return
+//1 with the next timer expiry in *next, or 0 when no timer is pending
+typedef int (* mote_boot_fn)(uint16_t id, uint16_t seed, unsigned long now,
+                             unsigned long *next);
+
+typedef int (* mote_input_fn)(uint16_t channel, uint16_t sender, uint16_t receiver,
+                              const void *data, uint16_t len, unsigned long now,
+                              unsigned long *next);
+
+typedef int (* mote_poll_fn)(unsigned long now, unsigned long *next);
+
+typedef unsigned long (* mote_clock_second_fn)(void);
+
+//raft_propose one byte on the current mote at now, 1 when it was queued.
+//The outcome arrives through the proposed hook with the same tag, run
+//mote_poll afterwards for the processes it woke
+typedef int (* mote_propose_fn)(uint32_t tag, unsigned long now);
+
+//raft_trace_dump, only there when the library is built with RAFT_TRACE_RING
+typedef void (* mote_trace_dump_fn)(void);
+
+#endif /* MOTE_H_ */
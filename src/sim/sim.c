@@ -0,0 +1,1405 @@
+/******************************
+
+* Raft Simulator
+
+* Runs N Raft motes in one host process on a virtual clock and an
+* in-process radio bus, ideal unless a channel model (channel.h) loses,
+* duplicates, delays or partitions frames or lets them collide. Every mote executes the unmodified raft.c and
+* raft_node.c loaded from raft-mote.so; like Cooja's native motes, the
+* library's writable data is swapped in and out per mote, so a run is
+* fully deterministic for a given seed.
+
+* For benchmarking a client proposes at a fixed rate to whichever mote lights the leader LED. Several runs with
+* consecutive seeds are summarized as percentiles of election time,
+* outage length and commit latency, and appended to CSV and JSON Lines
+* files so a sweep (make bench) can be compared across builds. The runs
+* are spread over a pool of threads, each with a private copy of the mote
+* library and so its own motes, stealing runs from each other once their
+* own share is done; their samples are merged at the end. Every run
+* depends only on its seed, so the results do not depend on the pool.
+
+*******************************/
+
+#define _GNU_SOURCE
+
+#include "mote.h"
+
+#include "channel.h"
+
+
+
+#include <dlfcn.h>
+
+#include <link.h>
+
+#include <pthread.h>
+
+#include <stdio.h>
+
+#include <stdint.h>
+
+#include <stdlib.h>
+
+#include <string.h>
+
+#include <time.h>
+
+#include <unistd.h>
+
+
+#define SIM_MAX_NODES 64
+
+#define RADIO_BYTE_US 32        //250 kbit/s 802.15.4 radio
+#define RADIO_OVERHEAD_BYTES 21 //PHY preamble/SFD/length, MAC header + FCS, rime header
+
+enum roles {role_off, role_follower, role_candidate, role_leader};
+
+static const char *role_names[] = {"off", "follower", "candidate", "leader"};
+
+struct sim_samples {
+
+  uint64_t *v;           //microseconds
+
+  size_t len;
+
+  size_t cap;
+
+};
+
+struct sim_frame {
+
+  uint64_t at;
+
+  uint32_t seq;
+
+  uint32_t tx;           //channel_transmit id, shared by every copy
+
+  uint16_t src;
+
+  uint16_t dst;
+
+  uint16_t channel;
+
+  uint16_t receiver;
+
+  uint16_t len;
+
+  uint8_t retries;       //MAC retransmissions after a collision
+
+  uint8_t duplicate;     //the second copy from channel_deliver
+
+  uint8_t data[MOTE_FRAME_SIZE];
+
+};
+
+//what happened to one log index in a run
+
+struct sim_entry {
+
+  uint32_t tag;            //1 + the tag of the client proposal it holds, 0 for none
+
+  uint16_t applied;        //motes that applied it
+
+  uint8_t value;           //the first of them applied
+
+  uint64_t appliedAt;      //by the last of them
+
+};
+
+struct sim_mote {
+
+  uint16_t id;
+
+  unsigned char *state;  //saved copy of the mote library's writable data
+
+  int timerPending;
+
+  uint64_t timerAt;
+
+  uint64_t txFreeAt;
+
+  uint64_t phase;        //of its clock, random with contention as no two crystals agree
+
+  enum roles role;
+
+  uint64_t leaderTime;   //total time spent as leader
+
+  uint64_t roleSince;
+
+};
+
+struct sim {
+
+  void *lib;
+
+  mote_bind_fn bind;
+
+  mote_boot_fn boot;
+
+  mote_input_fn input;
+
+  mote_poll_fn poll;
+
+  mote_propose_fn propose;
+
+  unsigned long clockSecond;
+
+  unsigned char *region;  //live writable data of the mote library
+
+  size_t regionLen;
+
+  unsigned char *pristine;
+
+  struct sim_mote motes[SIM_MAX_NODES];
+
+  int nodes;
+
+  int current;
+
+  uint64_t now;
+
+  struct sim_frame *queue; //min-heap on (at, seq)
+
+  size_t queueLen;
+
+  size_t queueCap;
+
+  uint32_t seq;
+
+  struct mote_hooks hooks;
+
+  int verbose;
+
+  int showRoles;
+
+  int dumpTrace;
+
+  int lineStart;
+
+  struct channel channel;
+
+  double rate;             //client proposals per second, 0 for none
+
+  uint64_t proposeAt;
+
+  uint64_t proposeCount;   //of this run, the next is proposeCount / rate seconds in
+
+  uint64_t *submitted;     //per proposal tag, when the client made it
+
+  size_t submittedCap;
+
+  uint32_t tags;           //of this run
+
+  struct sim_entry *entries; //of this run, by log index
+
+  size_t entriesCap;
+
+  int leaders;             //motes showing the leader LED
+
+  uint64_t leaderlessSince;
+
+  //stats, first leader of the current run, everything else summed over runs
+
+  uint64_t frames;
+
+  uint64_t bytes;
+
+  uint64_t firstLeaderAt;
+
+  int firstLeader;
+
+  unsigned int leaderChanges;
+
+  uint64_t diverged;       //entries two motes applied differently, never anything but 0
+
+  uint64_t proposed;
+
+  uint64_t rejected;       //no leader or its queue was full
+
+  uint64_t committed;
+
+  uint64_t failed;
+
+  uint64_t unknown;        //compacted before the leader could tell
+
+  struct sim_samples election;  //boot to first leader, one per run
+
+  struct sim_samples outage;    //no leader at all until the next one
+
+  struct sim_samples latency;   //proposal to applied on the leader
+
+  struct sim_samples everywhere; //proposal to applied on every mote
+
+};
+
+/*---------------------------------------------------------------------------*/
+
+static uint64_t splitmix64(uint64_t *x) {
+
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+
+}
+
+static unsigned long us_to_ticks(struct sim *s, uint64_t us) {
+
+  return (unsigned long)(us * s->clockSecond / 1000000);
+
+}
+
+static uint64_t ticks_to_us(struct sim *s, unsigned long ticks) {
+
+  return ((uint64_t)ticks * 1000000 + s->clockSecond - 1) / s->clockSecond;
+
+}
+
+//the clock of mote i now, its ticks fall phase microseconds after the simulator's
+static unsigned long mote_ticks(struct sim *s, int i) {
+
+  uint64_t phase = s->motes[i].phase;
+
+  return s->now > phase ? us_to_ticks(s, s->now - phase) : 0;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* samples */
+
+static void samples_push(struct sim_samples *x, uint64_t v) {
+
+  if (x->len == x->cap) {
+    x->cap = x->cap ? x->cap * 2 : 64;
+    x->v = realloc(x->v, x->cap * sizeof(*x->v));
+    if (x->v == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+
+  x->v[x->len++] = v;
+
+}
+
+//a latency from since to at, a sample that would go back in time means a
+//tag was reported for the wrong proposal and is left out rather than wrapped
+static void samples_push_latency(struct sim_samples *x, uint64_t at, uint64_t since) {
+
+  if (at < since) {
+    fprintf(stderr, "latency sample from %llu to %llu left out\n",
+      (unsigned long long)since, (unsigned long long)at);
+    return;
+  }
+
+  samples_push(x, at - since);
+
+}
+
+static int compare_u64(const void *a, const void *b) {
+
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+
+}
+
+//nearest rank, p in (0, 1], call after sorting
+static uint64_t samples_at(const struct sim_samples *x, double p) {
+
+  size_t rank = (size_t)(p * x->len + 0.999999);
+
+  return x->v[rank > 0 ? rank - 1 : 0];
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* frame queue */
+
+static int frame_before(const struct sim_frame *a, const struct sim_frame *b) {
+
+  return a->at < b->at || (a->at == b->at && a->seq < b->seq);
+
+}
+
+static void queue_push(struct sim *s, const struct sim_frame *f) {
+
+  size_t i;
+
+  if (s->queueLen == s->queueCap) {
+    s->queueCap = s->queueCap ? s->queueCap * 2 : 64;
+    s->queue = realloc(s->queue, s->queueCap * sizeof(*s->queue));
+    if (s->queue == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+
+  i = s->queueLen++;
+
+  while (i > 0 && frame_before(f, &s->queue[(i - 1) / 2])) {
+    s->queue[i] = s->queue[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+
+  s->queue[i] = *f;
+
+}
+
+static void queue_pop(struct sim *s, struct sim_frame *out) {
+
+  struct sim_frame last;
+  size_t i = 0;
+
+  *out = s->queue[0];
+  last = s->queue[--s->queueLen];
+
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= s->queueLen)
+      break;
+    if (child + 1 < s->queueLen && frame_before(&s->queue[child + 1], &s->queue[child]))
+      ++child;
+    if (!frame_before(&s->queue[child], &last))
+      break;
+    s->queue[i] = s->queue[child];
+    i = child;
+  }
+
+  if (s->queueLen > 0)
+    s->queue[i] = last;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//one transmission of f by mote index from, no earlier than ready and
+//after what its radio already has queued, with a copy for every mote the
+//channel lets it reach
+
+static void sim_transmit(struct sim *s, int from, struct sim_frame *f, uint64_t ready) {
+
+  struct sim_mote *m = &s->motes[from];
+  uint64_t start, airtime, delays[CHANNEL_COPIES];
+  int i, copies;
+
+  airtime = (uint64_t)(f->len + RADIO_OVERHEAD_BYTES) * RADIO_BYTE_US;
+  start = channel_transmit(&s->channel, m->txFreeAt > ready ? m->txFreeAt : ready,
+                           airtime, from, &f->tx);
+  m->txFreeAt = start + airtime;
+
+  ++s->frames;
+  s->bytes += f->len;
+
+  for (i = 0; i < s->nodes; ++i) {
+    if (i == from)
+      continue;
+    if (f->receiver != MOTE_BROADCAST && f->receiver != s->motes[i].id)
+      continue;
+    copies = channel_deliver(&s->channel, s->now, from, i, delays);
+    //a duplicate is the sender's retransmission after a lost ack
+    if (copies > 1)
+      delays[1] += airtime;
+    while (copies-- > 0) {
+      f->at = m->txFreeAt + delays[copies];
+      f->dst = (uint16_t)i;
+      f->seq = s->seq++;
+      f->duplicate = copies > 0;
+      queue_push(s, f);
+    }
+  }
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* mote hooks */
+
+static void hook_send(void *ctx, uint16_t channel, uint16_t receiver,
+                      const void *data, uint16_t len) {
+
+  struct sim *s = ctx;
+  struct sim_frame f;
+
+  f.src = s->motes[s->current].id;
+  f.channel = channel;
+  f.receiver = receiver;
+  f.len = len > MOTE_FRAME_SIZE ? MOTE_FRAME_SIZE : len;
+  f.retries = 0;
+  memcpy(f.data, data, f.len);
+
+  sim_transmit(s, s->current, &f, s->now);
+
+}
+
+static void hook_leds(void *ctx, unsigned char leds) {
+
+  struct sim *s = ctx;
+  struct sim_mote *m = &s->motes[s->current];
+  enum roles role;
+
+  //LED coding from the README: red follower, red+green candidate, green leader
+  if ((leds & 5) == 5)
+    role = role_candidate;
+  else if (leds & 1)
+    role = role_leader;
+  else if (leds & 4)
+    role = role_follower;
+  else
+    role = role_off;
+
+  if (role == m->role)
+    return;
+
+  if (m->role == role_leader) {
+    m->leaderTime += s->now - m->roleSince;
+    if (--s->leaders == 0)
+      s->leaderlessSince = s->now;
+  }
+
+  if (role == role_leader) {
+    if (s->leaders++ == 0 && s->firstLeader != 0)
+      samples_push(&s->outage, s->now - s->leaderlessSince);
+    ++s->leaderChanges;
+    if (s->firstLeader == 0) {
+      s->firstLeader = m->id;
+      s->firstLeaderAt = s->now;
+      samples_push(&s->election, s->now);
+    }
+  }
+
+  if (s->showRoles)
+    printf("%12.6f %3d: role %s -> %s\n", s->now / 1e6, m->id,
+           role_names[m->role], role_names[role]);
+
+  m->role = role;
+  m->roleSince = s->now;
+
+}
+
+static void hook_log(void *ctx, const char *fmt, va_list ap) {
+
+  struct sim *s = ctx;
+  size_t n = strlen(fmt);
+
+  if (s->lineStart)
+    printf("%12.6f %3d: ", s->now / 1e6, s->motes[s->current].id);
+
+  vprintf(fmt, ap);
+  s->lineStart = n > 0 && fmt[n - 1] == '\n';
+
+}
+
+static struct sim_entry *sim_entry(struct sim *s, uint32_t index) {
+
+  if (index >= s->entriesCap) {
+    size_t cap = s->entriesCap ? s->entriesCap : 1024;
+    while (cap <= index)
+      cap *= 2;
+    s->entries = realloc(s->entries, cap * sizeof(*s->entries));
+    if (s->entries == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+    memset(s->entries + s->entriesCap, 0, (cap - s->entriesCap) * sizeof(*s->entries));
+    s->entriesCap = cap;
+  }
+
+  return &s->entries[index];
+
+}
+
+static void hook_proposed(void *ctx, uint32_t tag, uint32_t index, int committed) {
+
+  struct sim *s = ctx;
+
+  if (committed > 0) {
+    ++s->committed;
+    samples_push_latency(&s->latency, s->now, s->submitted[tag]);
+    sim_entry(s, index)->tag = tag + 1;
+  }
+  else if (committed == 0) {
+    ++s->failed;
+  }
+  else {
+    ++s->unknown;
+  }
+
+}
+
+static void hook_applied(void *ctx, uint32_t index, uint8_t value) {
+
+  struct sim *s = ctx;
+  struct sim_entry *e = sim_entry(s, index);
+
+  if (e->applied == 0)
+    e->value = value;
+  else if (e->value != value) {
+    fprintf(stderr, "%12.6f %3d: applied %u at index %lu, another mote applied %u\n",
+            s->now / 1e6, s->motes[s->current].id, value, (unsigned long)index, e->value);
+    ++s->diverged;
+  }
+
+  ++e->applied;
+  e->appliedAt = s->now;
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* mote library */
+
+struct region_search {
+
+  uintptr_t base;
+
+  uintptr_t start;
+
+  uintptr_t end;
+
+};
+
+static int find_region(struct dl_phdr_info *info, size_t size, void *data) {
+
+  struct region_search *r = data;
+  uintptr_t relroEnd = 0;
+  int i;
+
+  (void)size;
+
+  if (info->dlpi_addr != r->base)
+    return 0;
+
+  for (i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+    if (ph->p_type == PT_GNU_RELRO)
+      relroEnd = info->dlpi_addr + ph->p_vaddr + ph->p_memsz;
+  }
+
+  for (i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+    if (ph->p_type == PT_LOAD && (ph->p_flags & PF_W)) {
+      r->start = info->dlpi_addr + ph->p_vaddr;
+      r->end = r->start + ph->p_memsz;
+    }
+  }
+
+  //the relro part is read only after relocation and identical for every mote
+  if (relroEnd > r->start && relroEnd < r->end) {
+    long page = sysconf(_SC_PAGESIZE);
+    r->start = (relroEnd + page - 1) & ~(uintptr_t)(page - 1);
+  }
+
+  return 1;
+
+}
+
+static void *lib_symbol(void *lib, const char *name) {
+
+  void *sym = dlsym(lib, name);
+
+  if (sym == NULL) {
+    fprintf(stderr, "mote library: %s\n", dlerror());
+    exit(1);
+  }
+
+  return sym;
+
+}
+
+static void sim_load(struct sim *s, const char *path) {
+
+  struct link_map *map;
+  struct region_search r = {0, 0, 0};
+  mote_clock_second_fn clockSecond;
+
+  s->lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (s->lib == NULL) {
+    fprintf(stderr, "%s\n", dlerror());
+    exit(1);
+  }
+
+  s->bind = (mote_bind_fn)lib_symbol(s->lib, "mote_bind");
+  s->boot = (mote_boot_fn)lib_symbol(s->lib, "mote_boot");
+  s->input = (mote_input_fn)lib_symbol(s->lib, "mote_input");
+  s->poll = (mote_poll_fn)lib_symbol(s->lib, "mote_poll");
+  s->propose = (mote_propose_fn)lib_symbol(s->lib, "mote_propose");
+  clockSecond = (mote_clock_second_fn)lib_symbol(s->lib, "mote_clock_second");
+  s->clockSecond = clockSecond();
+
+  if (dlinfo(s->lib, RTLD_DI_LINKMAP, &map) != 0) {
+    fprintf(stderr, "%s\n", dlerror());
+    exit(1);
+  }
+
+  r.base = map->l_addr;
+  dl_iterate_phdr(find_region, &r);
+  if (r.start == 0 || r.end <= r.start) {
+    fprintf(stderr, "%s: no writable segment\n", path);
+    exit(1);
+  }
+
+  s->region = (unsigned char *)r.start;
+  s->regionLen = r.end - r.start;
+
+  s->hooks.send = hook_send;
+  s->hooks.leds = hook_leds;
+  s->hooks.log = hook_log;
+  s->hooks.proposed = hook_proposed;
+  s->hooks.applied = hook_applied;
+  s->bind(&s->hooks, s, s->verbose);
+
+  s->pristine = malloc(s->regionLen);
+  memcpy(s->pristine, s->region, s->regionLen);
+
+}
+
+//dlopen maps a library once per file, so every worker loads its own copy
+
+static void sim_load_copy(struct sim *s, const char *path) {
+
+  char copy[] = "/tmp/raft-mote-XXXXXX";
+  char buf[65536];
+  FILE *in;
+  int out;
+  size_t n;
+
+  in = fopen(path, "rb");
+  if (in == NULL) {
+    perror(path);
+    exit(1);
+  }
+
+  out = mkstemp(copy);
+  if (out < 0) {
+    perror(copy);
+    exit(1);
+  }
+
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    if (write(out, buf, n) != (ssize_t)n) {
+      perror(copy);
+      exit(1);
+    }
+  }
+
+  fclose(in);
+  close(out);
+
+  sim_load(s, copy);
+  unlink(copy);
+
+}
+
+static void sim_switch(struct sim *s, int i) {
+
+  if (s->current == i)
+    return;
+
+  if (s->current >= 0)
+    memcpy(s->motes[s->current].state, s->region, s->regionLen);
+
+  memcpy(s->region, s->motes[i].state, s->regionLen);
+  s->current = i;
+
+}
+
+static void mote_done(struct sim *s, int i, int pending, unsigned long next) {
+
+  s->motes[i].timerPending = pending;
+  s->motes[i].timerAt = pending ? ticks_to_us(s, next) + s->motes[i].phase : 0;
+
+  //a timer the mote already considers due must still move time forward
+  if (pending && s->motes[i].timerAt <= s->now)
+    s->motes[i].timerAt = ticks_to_us(s, mote_ticks(s, i) + 1) + s->motes[i].phase;
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//boots every mote from scratch, also to start the next run of a benchmark
+
+static void sim_init(struct sim *s, int nodes, uint64_t seed) {
+
+  unsigned long next;
+  uint64_t x = seed;
+  int i;
+
+  s->nodes = nodes;
+  s->current = -1;
+  s->lineStart = 1;
+  s->now = 0;
+  s->queueLen = 0;
+  channel_reset(&s->channel, seed);
+  s->tags = 0;
+  if (s->entries != NULL)
+    memset(s->entries, 0, s->entriesCap * sizeof(*s->entries));
+  s->proposeCount = 1;
+  s->proposeAt = s->rate > 0 ? (uint64_t)(1e6 / s->rate) : 0;
+  s->leaders = 0;
+  s->firstLeader = 0;
+  s->firstLeaderAt = 0;
+
+  for (i = 0; i < nodes; ++i) {
+    struct sim_mote *m = &s->motes[i];
+    if (m->state == NULL)
+      m->state = malloc(s->regionLen);
+    memcpy(m->state, s->pristine, s->regionLen);
+    m->id = (uint16_t)(i + 1);
+    m->timerPending = 0;
+    m->txFreeAt = 0;
+    //otherwise every timer of every mote fires on the same microsecond
+    m->phase = s->channel.contention ? splitmix64(&x) % ticks_to_us(s, 1) : 0;
+    m->role = role_off;
+    m->leaderTime = 0;
+    m->roleSince = 0;
+  }
+
+  for (i = 0; i < nodes; ++i) {
+    int pending;
+    sim_switch(s, i);
+    pending = s->boot(s->motes[i].id, (uint16_t)splitmix64(&x), mote_ticks(s, i), &next);
+    mote_done(s, i, pending, next);
+  }
+
+}
+
+//the client of the benchmark: one proposal to the newest leader by the LEDs,
+//a rejected one is not retried
+
+static void sim_propose(struct sim *s) {
+
+  unsigned long next;
+  int leader = -1;
+  int pending;
+  int i;
+
+  s->proposeAt = (uint64_t)(++s->proposeCount * 1e6 / s->rate);
+
+  for (i = 0; i < s->nodes; ++i) {
+    if (s->motes[i].role == role_leader &&
+        (leader < 0 || s->motes[i].roleSince > s->motes[leader].roleSince))
+      leader = i;
+  }
+
+  if (leader < 0) {
+    ++s->rejected;
+    return;
+  }
+
+  if (s->tags == s->submittedCap) {
+    s->submittedCap = s->submittedCap ? s->submittedCap * 2 : 1024;
+    s->submitted = realloc(s->submitted, s->submittedCap * sizeof(*s->submitted));
+    if (s->submitted == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+
+  sim_switch(s, leader);
+
+  if (!s->propose(s->tags, mote_ticks(s, leader))) {
+    ++s->rejected;
+    return;
+  }
+
+  ++s->proposed;
+  s->submitted[s->tags++] = s->now;
+
+  pending = s->poll(mote_ticks(s, leader), &next);
+  mote_done(s, leader, pending, next);
+
+}
+
+static void sim_run(struct sim *s, uint64_t end) {
+
+  struct sim_frame f;
+  unsigned long next;
+  int pending;
+  size_t n;
+
+  for (;;) {
+    uint64_t t = UINT64_MAX;
+    int who = -1;
+    int i;
+
+    for (i = 0; i < s->nodes; ++i) {
+      if (s->motes[i].timerPending && s->motes[i].timerAt < t) {
+        t = s->motes[i].timerAt;
+        who = i;
+      }
+    }
+
+    if (s->rate > 0 && s->proposeAt < t &&
+        (s->queueLen == 0 || s->proposeAt < s->queue[0].at)) {
+      if (s->proposeAt > end)
+        break;
+      s->now = s->proposeAt;
+      sim_propose(s);
+    }
+    else if (s->queueLen > 0 && s->queue[0].at <= t) {
+      if (s->queue[0].at > end)
+        break;
+      queue_pop(s, &f);
+      s->now = f.at;
+      if (channel_collided(&s->channel, f.tx)) {
+        //no link-layer ack from the addressee, the sender's MAC tries again
+        if (f.receiver != MOTE_BROADCAST && !f.duplicate && f.retries < CHANNEL_RETRIES)
+          sim_transmit(s, f.src - 1, &f,
+                       s->now + channel_backoff(&s->channel, ++f.retries));
+        continue;
+      }
+      sim_switch(s, f.dst);
+      pending = s->input(f.channel, f.src, f.receiver, f.data, f.len,
+                         mote_ticks(s, f.dst), &next);
+      mote_done(s, f.dst, pending, next);
+    }
+    else if (who >= 0) {
+      if (t > end)
+        break;
+      s->now = t;
+      sim_switch(s, who);
+      pending = s->poll(mote_ticks(s, who), &next);
+      mote_done(s, who, pending, next);
+    }
+    else {
+      break;
+    }
+  }
+
+  s->now = end;
+
+  //an outage still going on counts up to the end of the run
+  if (s->leaders == 0 && s->firstLeader != 0)
+    samples_push(&s->outage, s->now - s->leaderlessSince);
+
+  //proposals every mote applied, a snapshot install skips the entries it covers
+  for (n = 0; n < s->entriesCap; ++n) {
+    struct sim_entry *e = &s->entries[n];
+    if (e->tag != 0 && e->applied == s->nodes)
+      samples_push_latency(&s->everywhere, e->appliedAt, s->submitted[e->tag - 1]);
+  }
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* worker pool for benchmarks. Each worker owns a range of run numbers and
+   takes runs from its front; an idle worker takes the back half of the
+   largest range left */
+
+struct sim_worker {
+
+  struct sim *s;
+
+  pthread_t thread;
+
+  pthread_mutex_t lock;
+
+  int next;                //runs [next, end) are still to do
+
+  int end;
+
+  struct sim_pool *pool;
+
+};
+
+struct sim_pool {
+
+  struct sim_worker *workers;
+
+  int count;
+
+  int nodes;
+
+  uint64_t seed;
+
+  uint64_t duration;
+
+};
+
+static int pool_take(struct sim_pool *p, struct sim_worker *w) {
+
+  int run = -1;
+
+  for (;;) {
+    struct sim_worker *victim = NULL;
+    int most = 0;
+    int i;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->next < w->end)
+      run = w->next++;
+    pthread_mutex_unlock(&w->lock);
+
+    if (run >= 0)
+      return run;
+
+    for (i = 0; i < p->count; ++i) {
+      struct sim_worker *v = &p->workers[i];
+      int left;
+      pthread_mutex_lock(&v->lock);
+      left = v->end - v->next;
+      pthread_mutex_unlock(&v->lock);
+      if (left > most) {
+        most = left;
+        victim = v;
+      }
+    }
+
+    if (victim == NULL)
+      return -1;
+
+    pthread_mutex_lock(&victim->lock);
+    most = victim->end - victim->next;
+    if (most > 0) {
+      int half = (most + 1) / 2;
+      pthread_mutex_lock(&w->lock);
+      w->next = victim->end - half;
+      w->end = victim->end;
+      pthread_mutex_unlock(&w->lock);
+      victim->end -= half;
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+
+}
+
+static void *pool_worker(void *arg) {
+
+  struct sim_worker *w = arg;
+  int run;
+
+  while ((run = pool_take(w->pool, w)) >= 0) {
+    sim_init(w->s, w->pool->nodes, w->pool->seed + run);
+    sim_run(w->s, w->pool->duration);
+  }
+
+  return NULL;
+
+}
+
+static void samples_merge(struct sim_samples *into, const struct sim_samples *from) {
+
+  size_t i;
+
+  for (i = 0; i < from->len; ++i)
+    samples_push(into, from->v[i]);
+
+}
+
+//adds the totals and samples of a worker to s
+static void sim_merge(struct sim *s, const struct sim *from) {
+
+  s->frames += from->frames;
+  s->bytes += from->bytes;
+  s->leaderChanges += from->leaderChanges;
+  s->diverged += from->diverged;
+  s->proposed += from->proposed;
+  s->rejected += from->rejected;
+  s->committed += from->committed;
+  s->failed += from->failed;
+  s->unknown += from->unknown;
+  s->channel.lost += from->channel.lost;
+  s->channel.cut += from->channel.cut;
+  s->channel.duplicated += from->channel.duplicated;
+  s->channel.collided += from->channel.collided;
+  s->channel.retries += from->channel.retries;
+
+  samples_merge(&s->election, &from->election);
+  samples_merge(&s->outage, &from->outage);
+  samples_merge(&s->latency, &from->latency);
+  samples_merge(&s->everywhere, &from->everywhere);
+
+}
+
+//runs seeds seed to seed + runs - 1 on count threads and merges them into s,
+//which holds the settings every worker starts from
+static void sim_pool_run(struct sim *s, const char *lib, int nodes, uint64_t seed,
+                         int runs, int count, uint64_t duration) {
+
+  struct sim_pool pool;
+  int i;
+
+  pool.workers = calloc(count, sizeof(*pool.workers));
+  pool.count = count;
+  pool.nodes = nodes;
+  pool.seed = seed;
+  pool.duration = duration;
+
+  for (i = 0; i < count; ++i) {
+    struct sim_worker *w = &pool.workers[i];
+    w->s = malloc(sizeof(*w->s));
+    if (w->s == NULL) {
+      perror("malloc");
+      exit(1);
+    }
+    memcpy(w->s, s, sizeof(*s));
+    sim_load_copy(w->s, lib);
+    pthread_mutex_init(&w->lock, NULL);
+    w->next = (int)((int64_t)runs * i / count);
+    w->end = (int)((int64_t)runs * (i + 1) / count);
+    w->pool = &pool;
+  }
+
+  for (i = 0; i < count; ++i) {
+    if (pthread_create(&pool.workers[i].thread, NULL, pool_worker, &pool.workers[i]) != 0) {
+      perror("pthread_create");
+      exit(1);
+    }
+  }
+
+  for (i = 0; i < count; ++i)
+    pthread_join(pool.workers[i].thread, NULL);
+
+  s->nodes = nodes;
+
+  for (i = 0; i < count; ++i)
+    sim_merge(s, pool.workers[i].s);
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+//print every mote's trace ring, with its output switched on for the dump
+
+static void sim_dump_trace(struct sim *s) {
+
+  mote_trace_dump_fn dump = (mote_trace_dump_fn)dlsym(s->lib, "raft_trace_dump");
+  int i;
+
+  if (dump == NULL) {
+    fprintf(stderr, "mote library built without a trace ring (TRACE_RING=0)\n");
+    return;
+  }
+
+  for (i = 0; i < s->nodes; ++i) {
+    sim_switch(s, i);
+    s->bind(&s->hooks, s, 1);
+    dump();
+  }
+
+}
+
+static void sim_report(struct sim *s, uint64_t seed, double wall) {
+
+  int i;
+
+  printf("nodes %d seed %llu simulated %.3f s wall %.3f s\n", s->nodes,
+         (unsigned long long)seed, s->now / 1e6, wall);
+  printf("frames %llu payload bytes %llu\n", (unsigned long long)s->frames,
+         (unsigned long long)s->bytes);
+  printf("channel lost %llu cut %llu duplicated %llu collided %llu\n",
+         (unsigned long long)s->channel.lost, (unsigned long long)s->channel.cut,
+         (unsigned long long)s->channel.duplicated, (unsigned long long)s->channel.collided);
+  printf("mac retries %llu\n", (unsigned long long)s->channel.retries);
+
+  if (s->firstLeader)
+    printf("first leader node %d at %.3f s\n", s->firstLeader, s->firstLeaderAt / 1e6);
+  else
+    printf("first leader none\n");
+
+  printf("leader changes %u\n", s->leaderChanges);
+
+  if (s->diverged > 0)
+    printf("diverged entries %llu\n", (unsigned long long)s->diverged);
+
+  for (i = 0; i < s->nodes; ++i) {
+    struct sim_mote *m = &s->motes[i];
+    uint64_t leaderTime = m->leaderTime;
+    if (m->role == role_leader)
+      leaderTime += s->now - m->roleSince;
+    printf("node %d %s leader time %.3f s\n", m->id, role_names[m->role], leaderTime / 1e6);
+  }
+
+}
+
+/*---------------------------------------------------------------------------*/
+/* benchmark results */
+
+#define RESULT_FIELDS 48
+
+struct sim_results {
+
+  const char *names[RESULT_FIELDS];
+
+  double values[RESULT_FIELDS];
+
+  int valid[RESULT_FIELDS]; //0 for a figure without samples, empty in CSV and null in JSON
+
+  int count;
+
+};
+
+static void result_add(struct sim_results *r, const char *name, double value, int valid) {
+
+  r->names[r->count] = name;
+  r->values[r->count] = value;
+  r->valid[r->count] = valid;
+  ++r->count;
+
+}
+
+//p50, p90, p99 and max of x in milliseconds, as name_p50_ms and so on
+static void result_percentiles(struct sim_results *r, const char *name, struct sim_samples *x) {
+
+  static const double ps[] = {0.5, 0.9, 0.99, 1.0};
+  static const char *suffixes[] = {"p50_ms", "p90_ms", "p99_ms", "max_ms"};
+  static char names[RESULT_FIELDS][48];
+  int i;
+
+  qsort(x->v, x->len, sizeof(*x->v), compare_u64);
+
+  for (i = 0; i < 4; ++i) {
+    snprintf(names[r->count], sizeof(names[r->count]), "%s_%s", name, suffixes[i]);
+    result_add(r, names[r->count], x->len > 0 ? samples_at(x, ps[i]) / 1e3 : 0, x->len > 0);
+  }
+
+}
+
+static void sim_results(struct sim *s, struct sim_results *r, int runs, double seconds) {
+
+  //per entry the client got committed, all traffic of the runs included
+  uint64_t entries = s->committed > 0 ? s->committed : 1;
+
+  r->count = 0;
+
+  result_add(r, "nodes", s->nodes, 1);
+  result_add(r, "loss", s->channel.loss, 1);
+  result_add(r, "burst_enter", s->channel.burstEnter, 1);
+  result_add(r, "burst_leave", s->channel.burstLeave, s->channel.burstEnter > 0);
+  result_add(r, "burst_loss", s->channel.burstLoss, s->channel.burstEnter > 0);
+  result_add(r, "duplicate", s->channel.duplicate, 1);
+  result_add(r, "reorder_ms", s->channel.reorder / 1e3, 1);
+  result_add(r, "partitions", s->channel.partitionCount, 1);
+  result_add(r, "contention", s->channel.contention, 1);
+  result_add(r, "rate", s->rate, 1);
+  result_add(r, "runs", runs, 1);
+  result_add(r, "seconds", seconds, 1);
+
+  result_add(r, "elected_runs", s->election.len, 1);
+  result_percentiles(r, "election", &s->election);
+  result_add(r, "outages", s->outage.len, 1);
+  result_percentiles(r, "outage", &s->outage);
+  result_add(r, "leader_changes_per_run", (double)s->leaderChanges / runs, 1);
+
+  result_add(r, "proposed", s->proposed, 1);
+  result_add(r, "rejected", s->rejected, 1);
+  result_add(r, "committed", s->committed, 1);
+  result_add(r, "failed", s->failed, 1);
+  result_add(r, "unknown", s->unknown, 1);
+  result_add(r, "committed_per_s", s->committed / (runs * seconds), 1);
+  result_percentiles(r, "commit", &s->latency);
+  result_percentiles(r, "applied_all", &s->everywhere);
+
+  result_add(r, "frames_per_entry", (double)s->frames / entries, s->committed > 0);
+  result_add(r, "bytes_per_entry", (double)s->bytes / entries, s->committed > 0);
+  result_add(r, "lost_frames", s->channel.lost, 1);
+  result_add(r, "cut_frames", s->channel.cut, 1);
+  result_add(r, "duplicated_frames", s->channel.duplicated, 1);
+  result_add(r, "collided_frames", s->channel.collided, 1);
+  result_add(r, "mac_retries", s->channel.retries, 1);
+  result_add(r, "diverged_entries", s->diverged, 1);
+
+}
+
+//appends one row, with a header line first if the file is new or empty
+static void write_csv(const char *path, const struct sim_results *r) {
+
+  FILE *f = fopen(path, "a");
+  int i;
+
+  if (f == NULL) {
+    perror(path);
+    exit(1);
+  }
+
+  if (ftell(f) == 0) {
+    for (i = 0; i < r->count; ++i)
+      fprintf(f, "%s%s", i ? "," : "", r->names[i]);
+    fputc('\n', f);
+  }
+
+  for (i = 0; i < r->count; ++i) {
+    fputs(i ? "," : "", f);
+    if (r->valid[i])
+      fprintf(f, "%.10g", r->values[i]);
+  }
+  fputc('\n', f);
+
+  fclose(f);
+
+}
+
+//appends one object per line (JSON Lines)
+static void write_json(const char *path, const struct sim_results *r) {
+
+  FILE *f = fopen(path, "a");
+  int i;
+
+  if (f == NULL) {
+    perror(path);
+    exit(1);
+  }
+
+  fputc('{', f);
+  for (i = 0; i < r->count; ++i) {
+    fprintf(f, "%s\"%s\": ", i ? ", " : "", r->names[i]);
+    if (r->valid[i])
+      fprintf(f, "%.10g", r->values[i]);
+    else
+      fputs("null", f);
+  }
+  fputs("}\n", f);
+
+  fclose(f);
+
+}
+
+static void print_results(const struct sim_results *r) {
+
+  int i;
+
+  for (i = 0; i < r->count; ++i) {
+    if (r->valid[i])
+      printf("%s %.10g\n", r->names[i], r->values[i]);
+    else
+      printf("%s -\n", r->names[i]);
+  }
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void usage(const char *prog) {
+
+  fprintf(stderr,
+          "usage: %s [-n nodes] [-s seed] [-d seconds] [-m mote.so] [-r] [-v] [-t]\n"
+          "       [-l loss] [-g enter,leave[,loss]] [-L from:to:prr] [-D dup] [-R ms]\n"
+          "       [-P start-end:id,...] [-C] [-p rate] [-b runs] [-w workers] [-c results.csv]\n"
+          "       [-j results.json]\n"
+          "  -n  number of motes (default 3)\n"
+          "  -s  random seed (default 1)\n"
+          "  -d  simulated duration in seconds (default 3600)\n"
+          "  -m  mote library (default raft-mote.so next to this program)\n"
+          "  -r  print role changes\n"
+          "  -v  print mote output\n"
+          "  -t  print each mote's trace ring at the end\n"
+          "  -l  percentage of frames each receiver misses (default 0)\n"
+          "  -g  Gilbert-Elliott bursts: per frame chance of a link turning bad\n"
+          "      and good again, and the loss while bad (default 1)\n"
+          "  -L  reception ratio of one direction of a link, repeatable\n"
+          "  -D  percentage of received frames that arrive twice\n"
+          "  -R  frames are held back up to this many ms, reordering them\n"
+          "  -P  cut the listed node ids off from the rest between two times in\n"
+          "      seconds, repeatable\n"
+          "  -C  transmissions contend for the air, CSMA backoff and collisions\n"
+          "  -p  client proposals per second to the leader (default 0, none)\n"
+          "  -b  runs with seeds seed, seed + 1, ... summarized as percentiles\n"
+          "  -w  threads for the runs (default one per core, 1 with -r, -v or -t)\n"
+          "  -c  append the results to a CSV file\n"
+          "  -j  append the results to a JSON Lines file\n", prog);
+  exit(2);
+
+}
+
+int main(int argc, char **argv) {
+
+  static struct sim s;
+  char defaultLib[4096];
+  static struct sim_results results;
+  const char *lib = NULL;
+  const char *csv = NULL;
+  const char *json = NULL;
+  uint64_t seed = 1;
+  double seconds = 3600;
+  int nodes = 3;
+  int runs = 1;
+  int workers = 0;
+  struct timespec t0, t1;
+  int opt;
+  int run;
+
+  channel_init(&s.channel);
+
+  while ((opt = getopt(argc, argv, "n:s:d:m:rvtl:g:L:D:R:P:Cp:b:w:c:j:")) != -1) {
+    switch (opt) {
+      case 'n': nodes = atoi(optarg); break;
+      case 's': seed = strtoull(optarg, NULL, 0); break;
+      case 'd': seconds = atof(optarg); break;
+      case 'm': lib = optarg; break;
+      case 'r': s.showRoles = 1; break;
+      case 'v': s.verbose = 1; break;
+      case 't': s.dumpTrace = 1; break;
+      case 'l': s.channel.loss = atof(optarg) / 100; break;
+      case 'g': if (!channel_parse_burst(&s.channel, optarg)) usage(argv[0]); break;
+      case 'L': if (!channel_parse_link(&s.channel, optarg)) usage(argv[0]); break;
+      case 'D': s.channel.duplicate = atof(optarg) / 100; break;
+      case 'R': s.channel.reorder = (uint64_t)(atof(optarg) * 1e3); break;
+      case 'P': if (!channel_parse_partition(&s.channel, optarg)) usage(argv[0]); break;
+      case 'C': s.channel.contention = 1; break;
+      case 'p': s.rate = atof(optarg); break;
+      case 'b': runs = atoi(optarg); break;
+      case 'w': workers = atoi(optarg); break;
+      case 'c': csv = optarg; break;
+      case 'j': json = optarg; break;
+      default: usage(argv[0]);
+    }
+  }
+
+  if (nodes < 1 || nodes > SIM_MAX_NODES || seconds <= 0 || runs < 1 || workers < 0 ||
+      s.channel.loss < 0 || s.channel.loss > 1 || s.channel.duplicate < 0 ||
+      s.channel.duplicate > 1 || s.rate < 0)
+    usage(argv[0]);
+
+  if (lib == NULL) {
+    const char *slash = strrchr(argv[0], '/');
+    int dirLen = slash ? (int)(slash - argv[0]) : 1;
+    snprintf(defaultLib, sizeof(defaultLib), "%.*s/raft-mote.so", dirLen,
+             slash ? argv[0] : ".");
+    lib = defaultLib;
+  }
+
+  //the output of several motes at once would interleave
+  if (s.verbose || s.showRoles || s.dumpTrace)
+    workers = 1;
+  else if (workers == 0)
+    workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (workers > runs)
+    workers = runs;
+  if (workers < 1)
+    workers = 1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (workers == 1) {
+    sim_load(&s, lib);
+    for (run = 0; run < runs; ++run) {
+      sim_init(&s, nodes, seed + run);
+      sim_run(&s, (uint64_t)(seconds * 1e6));
+    }
+  }
+  else {
+    sim_pool_run(&s, lib, nodes, seed, runs, workers, (uint64_t)(seconds * 1e6));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  if (s.dumpTrace)
+    sim_dump_trace(&s);
+
+  //a single run reports itself, a benchmark only the summary
+  if (runs == 1)
+    sim_report(&s, seed, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+  if (runs > 1 || s.rate > 0 || csv != NULL || json != NULL) {
+    sim_results(&s, &results, runs, seconds);
+    if (runs > 1)
+      printf("workers %d wall %.3f s\n", workers, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    print_results(&results);
+    if (csv != NULL)
+      write_csv(csv, &results);
+    if (json != NULL)
+      write_json(json, &results);
+  }
+
+  return 0;
+
+}